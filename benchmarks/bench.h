@@ -0,0 +1,107 @@
+#pragma once
+
+//
+// Result record shared by the benchmark payloads.
+//
+// Every payload takes a `bench::result*` as its second argument (RDX/EDX),
+// in user and kernel mode alike; the first argument is the payload's own
+// parameter (kernel mode: the kernel base). A null pointer is allowed, the
+// payload then runs without reporting.
+//
+// The caller may set `call_tsc` right before the call; the payload fills
+// in the rest. Together they split a run into:
+//
+//   call_tsc  .. entry_tsc   `_start` + `init()`: module and symbol
+//                            resolution
+//   entry_tsc .. work_tsc    setup inside `entry()` (allocations, filling
+//                            buffers)
+//   work_tsc  .. done_tsc    the workload itself
+//   done_tsc  .. (return)    `destroy()` and cleanup, timed by the caller
+//
+// `units` is the amount of work done (imports, bytes hashed, bytes
+// written), so runs of different sizes compare as cycles per unit.
+// `checksum` depends on every unit so the work can't be optimized away;
+// where it is deterministic it also tells whether two builds computed the
+// same thing.
+//
+// Timestamps are raw `rdtsc` reads, not serialized. `size` is written
+// last: a caller that zeroes the record sees `size == sizeof(result)` only
+// once the payload has run to the end (not if `init()` failed).
+//
+// The layout is the same on x86 and x64.
+//
+
+#include <cstdint>
+
+namespace bench {
+
+enum class payload : uint32_t {
+    import_heavy        = 1,
+    compute_heavy       = 2,
+    output_heavy        = 3,
+    kernel_import_heavy = 4,
+};
+
+struct result {
+    uint32_t size;
+    payload id;
+    uint64_t call_tsc;
+    uint64_t entry_tsc;
+    uint64_t work_tsc;
+    uint64_t done_tsc;
+    uint64_t units;
+    uint64_t checksum;
+};
+
+static_assert(sizeof(result) == 56, "bench::result layout must not depend on the target");
+
+__forceinline
+uint64_t tsc() {
+    return __builtin_ia32_rdtsc();
+}
+
+//
+// First thing in `entry()`.
+//
+
+__forceinline
+result* begin(void* argument, payload id) {
+    uint64_t Now = tsc();
+
+    auto Result = static_cast<result*>(argument);
+    if (Result) {
+        Result->id = id;
+        Result->entry_tsc = Now;
+        Result->work_tsc = Now;
+    }
+
+    return Result;
+}
+
+//
+// Setup is done, the measured work starts. Optional: without it, setup
+// counts as work.
+//
+
+__forceinline
+void start(result* result) {
+    uint64_t Now = tsc();
+
+    if (result) {
+        result->work_tsc = Now;
+    }
+}
+
+__forceinline
+void end(result* result, uint64_t units, uint64_t checksum) {
+    uint64_t Now = tsc();
+
+    if (result) {
+        result->done_tsc = Now;
+        result->units = units;
+        result->checksum = checksum;
+        result->size = sizeof(bench::result);
+    }
+}
+
+} // namespace bench
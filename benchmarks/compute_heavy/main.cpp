@@ -0,0 +1,95 @@
+//
+// Compute-heavy benchmark: hashes a large buffer, so the run is dominated
+// by code generated for the payload itself (optimization flags, LTO,
+// the crt0 routines) rather than by the runtime.
+//
+// The buffer is allocated and filled with a deterministic pattern during
+// setup (`entry_tsc .. work_tsc`); `work_tsc .. done_tsc` is a 64-bit
+// FNV-1a over all of it, a `memmove` of the buffer onto itself shifted
+// by one page, and a second hash over the result.
+//
+// argument1: buffer size in bytes, rounded down to a multiple of 4
+//            (4 KiB or less: 16 MiB)
+// argument2: bench::result* (optional)
+//
+// units:    bytes hashed (twice the buffer size)
+// checksum: the second hash (only depends on the buffer size)
+//
+
+#include <scfw/runtime.h>
+#include <scfw/platform/windows/usermode.h>
+
+#include <bench.h>
+
+IMPORT_BEGIN();
+    IMPORT_MODULE("kernel32.dll");
+        IMPORT_SYMBOL(VirtualAlloc);
+        IMPORT_SYMBOL(VirtualFree);
+IMPORT_END();
+
+namespace sc {
+
+#define DEFAULT_BUFFER_SIZE     (16 * 1024 * 1024)
+#define MOVE_DISTANCE           0x1000
+
+uint64_t fnv1a_64(const uint8_t* data, size_t size, uint64_t hash)
+{
+    for (size_t Index = 0; Index < size; Index++)
+    {
+        hash ^= data[Index];
+        hash *= 0x100000001b3;
+    }
+
+    return hash;
+}
+
+extern "C" void __fastcall entry(void* argument1, void* argument2)
+{
+    auto Result = bench::begin(argument2, bench::payload::compute_heavy);
+
+    size_t Size = reinterpret_cast<size_t>(argument1);
+    if (Size <= MOVE_DISTANCE)
+    {
+        Size = DEFAULT_BUFFER_SIZE;
+    }
+
+    Size &= ~size_t{ 3 };
+
+    auto Buffer = static_cast<uint8_t*>(VirtualAlloc(NULL,
+                                                     Size,
+                                                     MEM_COMMIT | MEM_RESERVE,
+                                                     PAGE_READWRITE));
+
+    if (!Buffer)
+    {
+        return;
+    }
+
+    //
+    // xorshift32: cheap, and no two pages look alike.
+    //
+
+    uint32_t State = 0x9E3779B9;
+    for (size_t Index = 0; Index < Size; Index += sizeof(uint32_t))
+    {
+        State ^= State << 13;
+        State ^= State >> 17;
+        State ^= State << 5;
+
+        uint32_t Word = State;
+        memcpy(Buffer + Index, &Word, sizeof(Word));
+    }
+
+    bench::start(Result);
+
+    uint64_t Hash = fnv1a_64(Buffer, Size, 0xcbf29ce484222325);
+
+    memmove(Buffer + MOVE_DISTANCE, Buffer, Size - MOVE_DISTANCE);
+    Hash = fnv1a_64(Buffer, Size, Hash);
+
+    bench::end(Result, 2 * uint64_t{ Size }, Hash);
+
+    VirtualFree(Buffer, 0, MEM_RELEASE);
+}
+
+} // namespace sc
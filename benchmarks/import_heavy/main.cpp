@@ -0,0 +1,215 @@
+//
+// Import-heavy benchmark: 300 imports across 10 DLLs, so that `init()`
+// dominates the run. `call_tsc .. entry_tsc` is the resolver's cost; the
+// work itself only reads every slot back.
+//
+// The imports mix every way the resolver can find a symbol:
+//
+//   - hashed module and symbol names (ntdll, kernelbase, ...)
+//   - string module names (kernel32, msvcrt) and string symbol names
+//     (per symbol in ntdll, for all of gdi32 and oleaut32)
+//   - forwarded exports: kernel32's heap, critical section and SRW lock
+//     functions and user32's `DefWindowProc*` are forwarders into ntdll
+//   - modules loaded with `LoadLibraryA` (DYNAMIC_LOAD): none of user32,
+//     gdi32, ws2_32, msvcrt, ole32, oleaut32 and crypt32 is guaranteed to
+//     be loaded in a console process
+//
+// All imports are value imports (`void*`), so no prototypes are needed.
+//
+// argument1: unused
+// argument2: bench::result* (optional)
+//
+// units:    number of imports
+// checksum: sum of the resolved addresses (changes with ASLR)
+//
+
+#define SCFW_ENABLE_LOAD_MODULE
+#define SCFW_ENABLE_FIND_MODULE_FORWARDER
+
+#include <scfw/runtime.h>
+#include <scfw/platform/windows/usermode.h>
+
+#include <bench.h>
+
+//
+// Symbol lists. Each is expanded twice: once as imports, once to read the
+// slots back in `entry()`.
+//
+
+#define NTDLL_SYMBOLS(X, S)                                                   \
+    X(NtClose) X(NtCreateFile) X(NtOpenFile) X(NtReadFile) X(NtWriteFile)     \
+    X(NtQueryInformationFile) X(NtSetInformationFile)                         \
+    X(NtQueryInformationProcess) X(NtQueryInformationThread)                  \
+    X(NtQuerySystemInformation) X(NtAllocateVirtualMemory)                    \
+    X(NtFreeVirtualMemory) X(NtProtectVirtualMemory) X(NtQueryVirtualMemory)  \
+    X(NtReadVirtualMemory) X(NtWriteVirtualMemory) X(NtCreateEvent)           \
+    X(NtSetEvent) X(NtResetEvent) X(NtWaitForSingleObject)                    \
+    X(NtWaitForMultipleObjects) X(NtDelayExecution) X(NtCreateSection)        \
+    X(NtMapViewOfSection) X(NtUnmapViewOfSection) X(NtOpenProcess)            \
+    X(NtOpenThread) X(NtSuspendThread) X(NtResumeThread)                      \
+    X(NtTerminateProcess) X(NtQueryPerformanceCounter) X(NtYieldExecution)    \
+    X(NtOpenKey) X(NtQueryValueKey) X(NtSetValueKey) X(NtDuplicateObject)     \
+    S(RtlAllocateHeap) S(RtlFreeHeap) S(RtlInitUnicodeString)                 \
+    S(RtlInitAnsiString) S(RtlCompareMemory) S(RtlCopyUnicodeString)          \
+    S(RtlGetVersion) S(RtlRandomEx) S(RtlComputeCrc32)
+
+#define KERNEL32_SYMBOLS(X)                                                   \
+    X(CreateFileA) X(CreateFileW) X(ReadFile) X(WriteFile) X(CloseHandle)     \
+    X(GetFileSize) X(SetFilePointer) X(DeleteFileA) X(DeleteFileW)            \
+    X(CreateDirectoryA) X(GetTempPathA) X(GetCurrentProcessId)                \
+    X(GetCurrentThreadId) X(GetTickCount) X(QueryPerformanceCounter)          \
+    X(QueryPerformanceFrequency) X(Sleep) X(SleepEx) X(CreateEventA)          \
+    X(SetEvent) X(ResetEvent) X(WaitForSingleObject) X(CreateThread)          \
+    X(ExitThread) X(GetLastError) X(SetLastError) X(VirtualAlloc)             \
+    X(VirtualFree) X(VirtualProtect) X(VirtualQuery) X(LoadLibraryA)          \
+    X(GetProcAddress) X(FreeLibrary) X(GetModuleHandleA)                      \
+    X(GetModuleFileNameA) X(GetSystemInfo) X(GetEnvironmentVariableA)         \
+    X(lstrlenA) X(MultiByteToWideChar) X(WideCharToMultiByte)                 \
+    /* Forwarded to ntdll. */                                                 \
+    X(HeapAlloc) X(HeapReAlloc) X(HeapSize) X(EnterCriticalSection)           \
+    X(LeaveCriticalSection) X(DeleteCriticalSection) X(InitializeSRWLock)     \
+    X(AcquireSRWLockExclusive) X(ReleaseSRWLockExclusive) X(DecodePointer)
+
+#define KERNELBASE_SYMBOLS(X)                                                 \
+    X(GetFileAttributesW) X(GetFileAttributesExW) X(FindFirstFileExW)         \
+    X(FindNextFileW) X(FindClose) X(GetFullPathNameW) X(GetCurrentDirectoryW) \
+    X(SetCurrentDirectoryW) X(GetTempPathW) X(CreateDirectoryW)               \
+    X(RemoveDirectoryW) X(GetCommandLineW) X(GetStartupInfoW)                 \
+    X(GetSystemTimeAsFileTime) X(GetLocalTime) X(FileTimeToSystemTime)        \
+    X(GetComputerNameExW) X(GetVersionExW) X(GetSystemDirectoryW)             \
+    X(GetWindowsDirectoryW) X(CompareStringW) X(LCMapStringW)                 \
+    X(GetLocaleInfoW) X(GetUserDefaultLCID) X(IsDebuggerPresent)              \
+    X(OutputDebugStringA) X(FlushFileBuffers) X(SetEndOfFile) X(GetFileType)  \
+    X(DuplicateHandle)
+
+#define USER32_SYMBOLS(X)                                                     \
+    X(MessageBoxA) X(MessageBoxW) X(GetDesktopWindow) X(GetForegroundWindow)  \
+    X(FindWindowA) X(FindWindowW) X(GetWindowTextA) X(GetWindowTextW)         \
+    X(SetWindowTextA) X(GetWindowRect) X(GetClientRect) X(ShowWindow)         \
+    X(UpdateWindow) X(CreateWindowExA) X(CreateWindowExW) X(DestroyWindow)    \
+    X(RegisterClassExA) X(RegisterClassExW) X(GetMessageA) X(PeekMessageA)    \
+    X(TranslateMessage) X(DispatchMessageA) X(PostQuitMessage)                \
+    X(GetSystemMetrics) X(GetCursorPos) X(SetCursorPos) X(GetDC) X(ReleaseDC) \
+    /* Forwarded to ntdll. */                                                 \
+    X(DefWindowProcA) X(DefWindowProcW)
+
+#define GDI32_SYMBOLS(X)                                                      \
+    X(CreateSolidBrush) X(DeleteObject) X(SelectObject) X(GetStockObject)     \
+    X(CreateFontA) X(CreateFontW) X(TextOutA) X(TextOutW) X(SetTextColor)     \
+    X(SetBkColor) X(SetBkMode) X(BitBlt) X(StretchBlt) X(CreateCompatibleDC)  \
+    X(CreateCompatibleBitmap) X(DeleteDC) X(GetDeviceCaps) X(Rectangle)       \
+    X(Ellipse) X(LineTo)
+
+#define WS2_32_SYMBOLS(X)                                                     \
+    X(WSAStartup) X(WSACleanup) X(WSAGetLastError) X(WSASetLastError)         \
+    X(WSASocketW) X(WSAIoctl) X(WSASend) X(WSARecv) X(socket) X(closesocket)  \
+    X(bind) X(listen) X(accept) X(connect) X(send) X(recv) X(sendto)          \
+    X(recvfrom) X(select) X(ioctlsocket) X(setsockopt) X(getsockopt) X(htons) \
+    X(ntohs) X(inet_addr)
+
+#define MSVCRT_SYMBOLS(X)                                                     \
+    X(qsort) X(bsearch) X(rand) X(srand) X(atoi) X(atol) X(atof) X(strtol)    \
+    X(strtoul) X(strtod) X(_itoa) X(_ultoa) X(_i64toa) X(_ui64toa)            \
+    X(_snprintf) X(sprintf) X(printf) X(puts) X(fopen) X(fclose) X(fread)     \
+    X(fwrite) X(fprintf) X(fflush) X(_strdup)
+
+#define OLE32_SYMBOLS(X)                                                      \
+    X(CoInitialize) X(CoInitializeEx) X(CoUninitialize) X(CoCreateInstance)   \
+    X(CoGetClassObject) X(CoTaskMemAlloc) X(CoTaskMemFree)                    \
+    X(CoTaskMemRealloc) X(CoCreateGuid) X(CoGetMalloc) X(CoGetCurrentProcess) \
+    X(CoFreeUnusedLibraries) X(CoRegisterClassObject) X(CoRevokeClassObject)  \
+    X(CoLockObjectExternal) X(CoMarshalInterface) X(CoUnmarshalInterface)     \
+    X(StringFromGUID2) X(StringFromCLSID) X(CLSIDFromString)                  \
+    X(CreateBindCtx) X(CreateStreamOnHGlobal) X(GetHGlobalFromStream)         \
+    X(OleInitialize) X(OleUninitialize)
+
+#define OLEAUT32_SYMBOLS(X)                                                   \
+    X(SysAllocString) X(SysAllocStringLen) X(SysAllocStringByteLen)           \
+    X(SysFreeString) X(SysReAllocString) X(SysStringLen) X(SysStringByteLen)  \
+    X(VariantInit) X(VariantClear) X(VariantCopy) X(VariantChangeType)        \
+    X(SafeArrayCreate) X(SafeArrayCreateVector) X(SafeArrayDestroy)           \
+    X(SafeArrayGetLBound) X(SafeArrayGetUBound) X(SafeArrayAccessData)        \
+    X(SafeArrayUnaccessData) X(SafeArrayGetElement) X(SafeArrayPutElement)    \
+    X(VarBstrCmp) X(VarBstrCat) X(LoadTypeLib) X(RegisterTypeLib)             \
+    X(SystemTimeToVariantTime)
+
+#define CRYPT32_SYMBOLS(X)                                                    \
+    X(CertOpenStore) X(CertOpenSystemStoreW) X(CertCloseStore)                \
+    X(CertEnumCertificatesInStore) X(CertFindCertificateInStore)              \
+    X(CertDuplicateCertificateContext) X(CertFreeCertificateContext)          \
+    X(CertGetCertificateContextProperty) X(CertGetNameStringW)                \
+    X(CertCreateCertificateContext) X(CertAddCertificateContextToStore)       \
+    X(CertGetCertificateChain) X(CertFreeCertificateChain)                    \
+    X(CertVerifyCertificateChainPolicy) X(CryptStringToBinaryA)               \
+    X(CryptStringToBinaryW) X(CryptBinaryToStringA) X(CryptBinaryToStringW)   \
+    X(CryptDecodeObjectEx) X(CryptEncodeObjectEx) X(CryptProtectData)         \
+    X(CryptUnprotectData) X(CryptQueryObject) X(CryptMsgOpenToDecode)         \
+    X(CryptMsgClose)
+
+#define BENCH_IMPORT(Name)          IMPORT_SYMBOL(Name, void*);
+#define BENCH_IMPORT_STRING(Name)   IMPORT_SYMBOL(Name, void*, FLAGS(SCFW_FLAG_STRING_SYMBOL));
+
+IMPORT_BEGIN();
+    IMPORT_MODULE("ntdll.dll");
+        NTDLL_SYMBOLS(BENCH_IMPORT, BENCH_IMPORT_STRING)
+
+    IMPORT_MODULE("kernel32.dll", FLAGS(SCFW_FLAG_STRING_MODULE));
+        KERNEL32_SYMBOLS(BENCH_IMPORT)
+
+    IMPORT_MODULE("kernelbase.dll");
+        KERNELBASE_SYMBOLS(BENCH_IMPORT)
+
+    IMPORT_MODULE("user32.dll", FLAGS(SCFW_FLAG_DYNAMIC_LOAD));
+        USER32_SYMBOLS(BENCH_IMPORT)
+
+    IMPORT_MODULE("gdi32.dll", FLAGS(SCFW_FLAG_DYNAMIC_LOAD | SCFW_FLAG_STRING_SYMBOL));
+        GDI32_SYMBOLS(BENCH_IMPORT)
+
+    IMPORT_MODULE("ws2_32.dll", FLAGS(SCFW_FLAG_DYNAMIC_LOAD));
+        WS2_32_SYMBOLS(BENCH_IMPORT)
+
+    IMPORT_MODULE("msvcrt.dll", FLAGS(SCFW_FLAG_DYNAMIC_LOAD | SCFW_FLAG_STRING_MODULE));
+        MSVCRT_SYMBOLS(BENCH_IMPORT)
+
+    IMPORT_MODULE("ole32.dll", FLAGS(SCFW_FLAG_DYNAMIC_LOAD));
+        OLE32_SYMBOLS(BENCH_IMPORT)
+
+    IMPORT_MODULE("oleaut32.dll", FLAGS(SCFW_FLAG_DYNAMIC_LOAD | SCFW_FLAG_STRING_SYMBOL));
+        OLEAUT32_SYMBOLS(BENCH_IMPORT)
+
+    IMPORT_MODULE("crypt32.dll", FLAGS(SCFW_FLAG_DYNAMIC_LOAD));
+        CRYPT32_SYMBOLS(BENCH_IMPORT)
+IMPORT_END();
+
+namespace sc {
+
+extern "C" void __fastcall entry(void* argument1, void* argument2)
+{
+    auto Result = bench::begin(argument2, bench::payload::import_heavy);
+
+    (void)argument1;
+
+    uint64_t Count = 0;
+    uint64_t Checksum = 0;
+
+#define BENCH_TOUCH(Name)                                                     \
+    Checksum += reinterpret_cast<uintptr_t>(static_cast<void*>(Name));        \
+    Count++;
+
+    NTDLL_SYMBOLS(BENCH_TOUCH, BENCH_TOUCH)
+    KERNEL32_SYMBOLS(BENCH_TOUCH)
+    KERNELBASE_SYMBOLS(BENCH_TOUCH)
+    USER32_SYMBOLS(BENCH_TOUCH)
+    GDI32_SYMBOLS(BENCH_TOUCH)
+    WS2_32_SYMBOLS(BENCH_TOUCH)
+    MSVCRT_SYMBOLS(BENCH_TOUCH)
+    OLE32_SYMBOLS(BENCH_TOUCH)
+    OLEAUT32_SYMBOLS(BENCH_TOUCH)
+    CRYPT32_SYMBOLS(BENCH_TOUCH)
+
+#undef BENCH_TOUCH
+
+    bench::end(Result, Count, Checksum);
+}
+
+} // namespace sc
@@ -0,0 +1,130 @@
+//
+// Kernel import-heavy benchmark: 178 imports from ntoskrnl, so that
+// `init()` - walking ntoskrnl's export table, which is several times the
+// size of any user-mode DLL's - dominates the run. `call_tsc .. entry_tsc`
+// is the resolver's cost; the work itself only reads every slot back.
+//
+// Functions are hashed, data exports (`*ObjectType`, `Mm*Address`, ...)
+// are looked up by string name. All imports are value imports (`void*`),
+// so no prototypes are needed.
+//
+// argument1: kernel base
+// argument2: bench::result* (optional; must be a kernel address)
+//
+// units:    number of imports
+// checksum: sum of the resolved addresses (changes with KASLR)
+//
+
+#include <scfw/runtime.h>
+#include <scfw/platform/windows/kernelmode.h>
+
+#include <bench.h>
+
+#define NTOSKRNL_SYMBOLS(X, S)                                                \
+    /* Ex */                                                                  \
+    X(ExAllocatePoolWithTag) X(ExFreePoolWithTag) X(ExAllocatePool)           \
+    X(ExFreePool) X(ExInitializeResourceLite) X(ExDeleteResourceLite)         \
+    X(ExAcquireResourceExclusiveLite) X(ExAcquireResourceSharedLite)          \
+    X(ExReleaseResourceLite) X(ExGetPreviousMode) X(ExSystemTimeToLocalTime)  \
+    X(ExUuidCreate) X(ExSetTimerResolution) S(ExEventObjectType)              \
+    /* Io */                                                                  \
+    X(IoAllocateMdl) X(IoFreeMdl) X(IoGetCurrentProcess) X(IoCreateDevice)    \
+    X(IoDeleteDevice) X(IoCreateSymbolicLink) X(IoDeleteSymbolicLink)         \
+    X(IoGetDeviceObjectPointer) X(IofCompleteRequest) X(IofCallDriver)        \
+    X(IoBuildDeviceIoControlRequest) X(IoAllocateIrp) X(IoFreeIrp)            \
+    X(IoGetRelatedDeviceObject) X(IoAllocateWorkItem) X(IoQueueWorkItem)      \
+    X(IoFreeWorkItem) X(IoThreadToProcess) S(IoFileObjectType)                \
+    S(IoDriverObjectType)                                                     \
+    /* Ke */                                                                  \
+    X(KeInitializeEvent) X(KeSetEvent) X(KeResetEvent) X(KeClearEvent)        \
+    X(KeWaitForSingleObject) X(KeWaitForMultipleObjects)                      \
+    X(KeDelayExecutionThread) X(KeInitializeTimer) X(KeSetTimer)              \
+    X(KeCancelTimer) X(KeInitializeDpc) X(KeInsertQueueDpc)                   \
+    X(KeRemoveQueueDpc) X(KeStackAttachProcess) X(KeUnstackDetachProcess)     \
+    X(KeEnterCriticalRegion) X(KeLeaveCriticalRegion) X(KeInitializeMutex)    \
+    X(KeReleaseMutex) X(KeInitializeSemaphore) X(KeReleaseSemaphore)          \
+    X(KeBugCheckEx) X(KeQueryActiveProcessorCount)                            \
+    X(KeGetCurrentProcessorNumberEx) X(KeSetPriorityThread)                   \
+    X(KeQueryTimeIncrement)                                                   \
+    /* Mm */                                                                  \
+    X(MmGetSystemRoutineAddress) X(MmMapLockedPagesSpecifyCache)              \
+    X(MmUnmapLockedPages) X(MmProbeAndLockPages) X(MmUnlockPages)             \
+    X(MmBuildMdlForNonPagedPool) X(MmIsAddressValid) X(MmGetPhysicalAddress)  \
+    X(MmMapIoSpace) X(MmUnmapIoSpace) X(MmAllocateContiguousMemory)           \
+    X(MmFreeContiguousMemory) X(MmIsNonPagedSystemAddressValid)               \
+    S(MmHighestUserAddress) S(MmSystemRangeStart) S(MmUserProbeAddress)       \
+    /* Ob */                                                                  \
+    X(ObReferenceObjectByHandle) X(ObReferenceObjectByPointer)                \
+    X(ObfReferenceObject) X(ObfDereferenceObject) X(ObOpenObjectByPointer)    \
+    X(ObCloseHandle) X(ObRegisterCallbacks) X(ObUnRegisterCallbacks)          \
+    X(ObGetFilterVersion) X(ObQueryNameString)                                \
+    /* Ps */                                                                  \
+    X(PsGetCurrentProcessId) X(PsGetCurrentThreadId) X(PsGetProcessId)        \
+    X(PsGetThreadId) X(PsLookupProcessByProcessId)                            \
+    X(PsLookupThreadByThreadId) X(PsGetProcessImageFileName)                  \
+    X(PsGetProcessPeb) X(PsCreateSystemThread) X(PsTerminateSystemThread)     \
+    X(PsSetCreateProcessNotifyRoutine) X(PsSetCreateProcessNotifyRoutineEx)   \
+    X(PsSetCreateThreadNotifyRoutine) X(PsSetLoadImageNotifyRoutine)          \
+    X(PsRemoveCreateThreadNotifyRoutine) X(PsRemoveLoadImageNotifyRoutine)    \
+    X(PsReferencePrimaryToken) X(PsDereferencePrimaryToken) X(PsGetVersion)   \
+    X(PsIsSystemThread) X(PsGetProcessExitStatus)                             \
+    S(PsInitialSystemProcess) S(PsProcessType) S(PsThreadType)                \
+    /* Rtl */                                                                 \
+    X(RtlInitUnicodeString) X(RtlInitAnsiString) X(RtlCopyUnicodeString)      \
+    X(RtlCompareUnicodeString) X(RtlEqualUnicodeString)                       \
+    X(RtlAppendUnicodeToString) X(RtlAppendUnicodeStringToString)             \
+    X(RtlUnicodeStringToAnsiString) X(RtlAnsiStringToUnicodeString)           \
+    X(RtlFreeUnicodeString) X(RtlFreeAnsiString) X(RtlGetVersion)             \
+    X(RtlCompareMemory) X(RtlRandomEx) X(RtlConvertSidToUnicodeString)        \
+    X(RtlIntegerToUnicodeString) X(RtlUnicodeStringToInteger)                 \
+    X(RtlTimeToTimeFields) X(RtlCreateSecurityDescriptor) X(RtlLengthSid)     \
+    X(RtlValidSid) X(RtlImageNtHeader) X(RtlPcToFileHeader)                   \
+    X(RtlCaptureContext)                                                      \
+    /* Zw */                                                                  \
+    X(ZwClose) X(ZwCreateFile) X(ZwOpenFile) X(ZwReadFile) X(ZwWriteFile)     \
+    X(ZwQueryInformationFile) X(ZwSetInformationFile) X(ZwCreateKey)          \
+    X(ZwOpenKey) X(ZwQueryValueKey) X(ZwSetValueKey) X(ZwDeleteKey)           \
+    X(ZwEnumerateKey) X(ZwFlushKey) X(ZwQuerySystemInformation)               \
+    X(ZwQueryInformationProcess) X(ZwOpenProcess) X(ZwTerminateProcess)       \
+    X(ZwAllocateVirtualMemory) X(ZwFreeVirtualMemory) X(ZwCreateSection)      \
+    X(ZwMapViewOfSection) X(ZwUnmapViewOfSection) X(ZwWaitForSingleObject)    \
+    X(ZwQueryInformationToken) X(ZwOpenProcessTokenEx) X(ZwCreateEvent)       \
+    X(ZwSetEvent) X(ZwDuplicateObject) X(ZwQueryDirectoryFile)                \
+    /* Se, Cm, Fs, Dbg */                                                     \
+    X(SeSinglePrivilegeCheck) X(SeCaptureSubjectContext)                      \
+    X(SeReleaseSubjectContext) X(SeQueryInformationToken) X(SeAccessCheck)    \
+    X(CmRegisterCallback) X(CmUnRegisterCallback) X(FsRtlIsNameInExpression)  \
+    X(DbgPrint) X(DbgPrintEx) X(DbgBreakPoint) S(SeTokenObjectType)           \
+    S(SeExports) S(KeNumberProcessors)
+
+#define BENCH_IMPORT(Name)          IMPORT_SYMBOL(Name, void*);
+#define BENCH_IMPORT_STRING(Name)   IMPORT_SYMBOL(Name, void*, FLAGS(SCFW_FLAG_STRING_SYMBOL));
+
+IMPORT_BEGIN();
+    IMPORT_MODULE("ntoskrnl.exe");
+        NTOSKRNL_SYMBOLS(BENCH_IMPORT, BENCH_IMPORT_STRING)
+IMPORT_END();
+
+namespace sc {
+
+extern "C" void __fastcall entry(void* argument1, void* argument2)
+{
+    auto Result = bench::begin(argument2, bench::payload::kernel_import_heavy);
+
+    (void)argument1; // Kernel ImageBase, unused.
+
+    uint64_t Count = 0;
+    uint64_t Checksum = 0;
+
+#define BENCH_TOUCH(Name)                                                     \
+    Checksum += reinterpret_cast<uintptr_t>(static_cast<void*>(Name));        \
+    Count++;
+
+    NTOSKRNL_SYMBOLS(BENCH_TOUCH, BENCH_TOUCH)
+
+#undef BENCH_TOUCH
+
+    bench::end(Result, Count, Checksum);
+}
+
+} // namespace sc
@@ -0,0 +1,84 @@
+//
+// Output-heavy benchmark: formats and writes many short lines to standard
+// output, one `WriteFile` per line, the way a chatty payload reports
+// progress. The run is dominated by the call path into kernel32 and the
+// console (or whatever stdout is redirected to - redirect to NUL to
+// measure the payload side alone).
+//
+// `WriteFile` rather than `WriteConsoleA`, so that redirected output is
+// written as well.
+//
+// argument1: number of lines (0: 10000)
+// argument2: bench::result* (optional)
+//
+// units:    bytes written
+// checksum: lines written successfully
+//
+
+#include <scfw/runtime.h>
+#include <scfw/platform/windows/usermode.h>
+
+#include <bench.h>
+
+IMPORT_BEGIN();
+    IMPORT_MODULE("kernel32.dll");
+        IMPORT_SYMBOL(WriteFile);
+IMPORT_END();
+
+namespace sc {
+
+#define DEFAULT_LINE_COUNT      10000
+#define LINE_TEMPLATE           "scfw output benchmark: line 0000000000\n"
+
+//
+// Writes `value` right-aligned into `buffer[0 .. width)`, zero-padded.
+//
+
+void format_decimal(char* buffer, size_t width, size_t value)
+{
+    while (width--)
+    {
+        buffer[width] = static_cast<char>('0' + value % 10);
+        value /= 10;
+    }
+}
+
+extern "C" void __fastcall entry(void* argument1, void* argument2)
+{
+    auto Result = bench::begin(argument2, bench::payload::output_heavy);
+
+    size_t LineCount = reinterpret_cast<size_t>(argument1);
+    if (!LineCount)
+    {
+        LineCount = DEFAULT_LINE_COUNT;
+    }
+
+    HANDLE StdOut = NtCurrentPeb()->ProcessParameters->StandardOutput;
+
+    constexpr size_t LineLength = sizeof(LINE_TEMPLATE) - 1;
+    constexpr size_t NumberOffset = LineLength - 11;
+
+    char Line[LineLength];
+    memcpy(Line, _T(LINE_TEMPLATE), LineLength);
+
+    uint64_t BytesWritten = 0;
+    uint64_t LinesWritten = 0;
+
+    bench::start(Result);
+
+    for (size_t Index = 0; Index < LineCount; Index++)
+    {
+        format_decimal(Line + NumberOffset, 10, Index);
+
+        DWORD Written;
+        if (WriteFile(StdOut, Line, LineLength, &Written, NULL))
+        {
+            BytesWritten += Written;
+            LinesWritten++;
+        }
+    }
+
+    bench::end(Result, BytesWritten, LinesWritten);
+}
+
+} // namespace sc
@@ -2,6 +2,8 @@
 option(SCFW_OPT_LTO "Enable Link-Time Optimization" ON)
 option(SCFW_OPT_DEBUG_INFO "Enable debug info in output binary (PDB/CodeView on Windows)" OFF)
 option(SCFW_OPT_CLEANUP "Enable self-cleanup (free shellcode memory on exit)" OFF)
+option(SCFW_OPT_DETACH "Run entry() on a new thread and return to the caller immediately" OFF)
+option(SCFW_OPT_RESULT "Return entry()'s status and the failed import to the caller" OFF)
 option(SCFW_OPT_ZERO_BASE "Set PE image base to 0 on x86" OFF)
 set(SCFW_FUNCTION_ALIGNMENT 1 CACHE STRING "Function alignment in bytes (default=1)")
 set(SCFW_FILE_ALIGNMENT 1 CACHE STRING "PE file alignment in bytes (default=1)")
@@ -57,6 +59,7 @@ set(SCFW_COMPILE_FLAGS
 if(CMAKE_SYSTEM_PROCESSOR STREQUAL "X86")
     list(APPEND SCFW_COMPILE_FLAGS
         -mno-sse
+        -fno-jump-tables           # Jump table entries are absolute addresses
         -Xclang -fdefault-calling-conv=fastcall
     )
 endif()
@@ -153,6 +156,50 @@ define_property(DIRECTORY PROPERTY SCFW_OPT_CLEANUP INHERITED
                " Default: OFF.")
 set_property(GLOBAL PROPERTY SCFW_OPT_CLEANUP ${SCFW_OPT_CLEANUP})
 
+define_property(TARGET PROPERTY SCFW_OPT_DETACH INHERITED
+    BRIEF_DOCS "Enable detached execution"
+    FULL_DOCS  "_entry initializes the dispatch table, starts a new thread"
+               " (RtlCreateUserThread / PsCreateSystemThread) that runs"
+               " entry() and returns to the caller right away. Combined"
+               " with SCFW_OPT_CLEANUP, the new thread frees the shellcode."
+               " Maps to SCFW_ENABLE_DETACH and controls whether detach.S"
+               " is linked in."
+               " Default: OFF.")
+define_property(DIRECTORY PROPERTY SCFW_OPT_DETACH INHERITED
+    BRIEF_DOCS "Enable detached execution"
+    FULL_DOCS  "_entry initializes the dispatch table, starts a new thread"
+               " (RtlCreateUserThread / PsCreateSystemThread) that runs"
+               " entry() and returns to the caller right away. Combined"
+               " with SCFW_OPT_CLEANUP, the new thread frees the shellcode."
+               " Maps to SCFW_ENABLE_DETACH and controls whether detach.S"
+               " is linked in."
+               " Default: OFF.")
+set_property(GLOBAL PROPERTY SCFW_OPT_DETACH ${SCFW_OPT_DETACH})
+
+define_property(TARGET PROPERTY SCFW_OPT_RESULT INHERITED
+    BRIEF_DOCS "Enable result reporting"
+    FULL_DOCS  "entry() returns a uintptr_t status that _entry returns to the"
+               " caller and stores, together with the FNV-1a hash of the"
+               " import init() failed on, through an optional third"
+               " argument (sc::entry_result*). With SCFW_OPT_CLEANUP the"
+               " return register holds the VirtualFree / ExFreePool result,"
+               " so only the third argument carries the status."
+               " Maps to SCFW_ENABLE_RESULT and changes the startup assembly."
+               " Not compatible with SCFW_OPT_DETACH."
+               " Default: OFF.")
+define_property(DIRECTORY PROPERTY SCFW_OPT_RESULT INHERITED
+    BRIEF_DOCS "Enable result reporting"
+    FULL_DOCS  "entry() returns a uintptr_t status that _entry returns to the"
+               " caller and stores, together with the FNV-1a hash of the"
+               " import init() failed on, through an optional third"
+               " argument (sc::entry_result*). With SCFW_OPT_CLEANUP the"
+               " return register holds the VirtualFree / ExFreePool result,"
+               " so only the third argument carries the status."
+               " Maps to SCFW_ENABLE_RESULT and changes the startup assembly."
+               " Not compatible with SCFW_OPT_DETACH."
+               " Default: OFF.")
+set_property(GLOBAL PROPERTY SCFW_OPT_RESULT ${SCFW_OPT_RESULT})
+
 define_property(TARGET PROPERTY SCFW_FUNCTION_ALIGNMENT INHERITED
     BRIEF_DOCS "Function alignment in bytes"
     FULL_DOCS  "Controls padding between functions."
@@ -14,7 +14,11 @@
 #include <phnt_windows.h>
 #include <phnt.h>
 
+#include <iterator>
+#include <utility>
+
 #include "../../runtime/fnv1a.h"
+#include "pe.h"
 
 namespace sc {
 namespace detail {
@@ -52,102 +56,177 @@ namespace windows {
 //
 //
 // Forwarded Exports (optional, enable with `SCFW_ENABLE_FIND_MODULE_FORWARDER`):
-//   Some exports don't contain code - they redirect to another DLL.
+//   Some exports don't contain code - they redirect to another module.
 //   A forwarded export's RVA falls within the export directory bounds,
 //   and points to a string like "NTDLL.RtlAllocateHeap" instead of code.
 //   When enabled, we detect this and recursively resolve the target.
 //
+//   The target module is named without its extension ("NTDLL", "HAL",
+//   "ntoskrnl"), so it is matched by the hash of the name up to the first
+//   dot (`module_stem_hash()`). Finding the module is mode-specific: the
+//   caller passes a `resolver` mapping that hash to a module base - the
+//   PEB walk in usermode, the module snapshot in kernelmode. The function
+//   name is hashed as well, so no string is ever copied.
+//
 
-#ifdef SCFW_ENABLE_FIND_MODULE_FORWARDER
-namespace usermode {
-    void* find_module(const char* name);
-} // namespace usermode
+//
+// FNV-1a hash of a module name up to its extension. "NTDLL", "ntdll.dll"
+// and "ntdll" all produce the same hash.
+//
 
-template <typename F>
-F lookup_symbol(void* module, const char* name);
-#endif
+template <typename T>
+__forceinline
+uint32_t module_stem_hash(const T* name) {
+    size_t Length = 0;
+    while (name[Length] && name[Length] != '.') Length++;
+    return fnv1a_hash(name, Length);
+}
 
-template <typename F, typename C>
+//
+// Default forwarder resolver: forwarded exports resolve to `nullptr`.
+//
+
+struct no_forwarder {
+    __forceinline
+    void* operator()(uint32_t module_hash) const {
+        (void)module_hash;
+        return nullptr;
+    }
+};
+
+template <typename F, typename R = no_forwarder>
+F lookup_symbol(void* module, uint32_t hash, R resolver = {});
+
+template <typename F, typename C, typename R>
 __forceinline
-F lookup_symbol_impl(void* module, C comparator) {
-    PUCHAR ImageBase = (PUCHAR)module;
-    PIMAGE_DOS_HEADER DosHeader = (PIMAGE_DOS_HEADER)module;
-    PIMAGE_NT_HEADERS NtHeaders = (PIMAGE_NT_HEADERS)(ImageBase + DosHeader->e_lfanew);
+F lookup_symbol_impl(void* module, C comparator, R resolver) {
+    pe::unchecked_image_view Image{ module };
+    auto Exports = Image.exports();
 
-#ifdef SCFW_ENABLE_FIND_MODULE_FORWARDER
-    DWORD ExportDirRVA = NtHeaders->OptionalHeader.DataDirectory[IMAGE_DIRECTORY_ENTRY_EXPORT].VirtualAddress;
-    DWORD ExportDirSize = NtHeaders->OptionalHeader.DataDirectory[IMAGE_DIRECTORY_ENTRY_EXPORT].Size;
-    PIMAGE_EXPORT_DIRECTORY Exports = (PIMAGE_EXPORT_DIRECTORY)(ImageBase + ExportDirRVA);
-#else
-    PIMAGE_EXPORT_DIRECTORY Exports =
-        (PIMAGE_EXPORT_DIRECTORY)(ImageBase + NtHeaders->OptionalHeader.DataDirectory[IMAGE_DIRECTORY_ENTRY_EXPORT].VirtualAddress);
+#ifndef SCFW_ENABLE_FIND_MODULE_FORWARDER
+    (void)resolver;
 #endif
 
-    PULONG Names = (PULONG)(ImageBase + Exports->AddressOfNames);
-    for (ULONG Index = Exports->NumberOfNames; Index--;) {
-        LPCSTR Name = (LPCSTR)(ImageBase + Names[Index]);
-        if (comparator(Name)) {
-            PULONG Functions = (PULONG)(ImageBase + Exports->AddressOfFunctions);
-            PUSHORT Ordinals = (PUSHORT)(ImageBase + Exports->AddressOfNameOrdinals);
-            DWORD FunctionRVA = Functions[Ordinals[Index]];
+    for (ULONG Index = Exports.size(); Index--;) {
+        if (comparator(Exports.name(Index))) {
+            DWORD FunctionRVA = Exports.function(Exports.ordinal(Index));
 
 #ifdef SCFW_ENABLE_FIND_MODULE_FORWARDER
             // Check if this is a forwarded export.
             // Forwarded exports have their RVA pointing within the export directory,
             // where a string like "NTDLL.NtdllDefWindowProc_A" is stored.
-            if (FunctionRVA >= ExportDirRVA && FunctionRVA < ExportDirRVA + ExportDirSize) {
-                LPCSTR ForwardStr = (LPCSTR)(ImageBase + FunctionRVA);
-                // Find the dot separator between DLL name and function name.
+            if (Exports.forwarded(FunctionRVA)) {
+                LPCSTR ForwardStr = Exports.forwarder(FunctionRVA);
+                // Find the dot separator between module name and function name.
                 LPCSTR Dot = ForwardStr;
                 while (*Dot && *Dot != '.') Dot++;
                 if (!*Dot) return nullptr;
 
-                // Build DLL name with .dll extension.
-                // Forward strings use "NTDLL" not "ntdll.dll", so we append ".dll".
-                char DllName[64];
-                size_t DllNameLen = Dot - ForwardStr;
-                if (DllNameLen + 5 > sizeof(DllName)) return nullptr;
-
-                strcpy(DllName, ForwardStr);
-                DllName[DllNameLen + 0] = '.';
-                DllName[DllNameLen + 1] = 'd';
-                DllName[DllNameLen + 2] = 'l';
-                DllName[DllNameLen + 3] = 'l';
-                DllName[DllNameLen + 4] = '\0';
-
                 // Function name follows the dot.
                 LPCSTR FuncName = Dot + 1;
 
                 // Ordinal forwards start with '#' - not supported.
                 if (*FuncName == '#') return nullptr;
 
-                // Find the target module in the PEB.
-                // #TODO: Using forwarder in kernel-mode is unsupported for now.
-                void* TargetModule = usermode::find_module(DllName);
+                // Find the target module (PEB or module snapshot).
+                void* TargetModule = resolver(fnv1a_hash(ForwardStr, size_t(Dot - ForwardStr)));
                 if (!TargetModule) return nullptr;
 
                 // Recursively resolve in the target module.
-                return lookup_symbol<F>(TargetModule, FuncName);
+                return lookup_symbol<F>(TargetModule, fnv1a_hash(FuncName), resolver);
             }
 #endif
 
-            return reinterpret_cast<F>((PVOID)(ImageBase + FunctionRVA));
+            return reinterpret_cast<F>((PVOID)(Image.base() + FunctionRVA));
         }
     }
     return nullptr;
 }
 
-template <typename F>
-F lookup_symbol(void* module, const char* name) {
+template <typename F, typename R = no_forwarder>
+F lookup_symbol(void* module, const char* name, R resolver = {}) {
     return lookup_symbol_impl<F>(module, [name](const char* export_name) {
         return strcmp(export_name, name) == 0;
-    });
+    }, resolver);
 }
 
-template <typename F>
-F lookup_symbol(void* module, uint32_t hash) {
+template <typename F, typename R>
+F lookup_symbol(void* module, uint32_t hash, R resolver) {
     return lookup_symbol_impl<F>(module, [hash](const char* export_name) {
         return fnv1a_hash(export_name) == hash;
+    }, resolver);
+}
+
+//
+// Whether `module` is the build with the given `TimeDateStamp` and
+// `SizeOfImage` - the key of the pinned RVA database (`runtime/pinned.h`).
+//
+
+__forceinline
+bool image_matches(void* module, uint32_t time_date_stamp, uint32_t size_of_image) {
+    pe::unchecked_image_view Image{ module };
+
+    return Image.nt_headers()->FileHeader.TimeDateStamp == time_date_stamp
+        && Image.size() == size_of_image;
+}
+
+//
+// IAT scavenging (`SCFW_FLAG_SCAVENGE_IAT`).
+//
+// An image that imports a function by name already holds its resolved
+// address: the loader wrote it into the IAT slot paired with the hint/name
+// entry. Walking the import descriptors of such an image (a few dozen
+// names for one module) is much cheaper than searching the target's export
+// table (thousands of names):
+//
+//   IMAGE_IMPORT_DESCRIPTOR ("KERNEL32.dll")
+//    +- OriginalFirstThunk --> [ "Sleep" ][ "ExitProcess" ][ 0 ]
+//    +- FirstThunk ----------> [ 0x7ff8.. ][ 0x7ff8..     ][ 0 ]
+//
+// Only descriptors with an import lookup table (`OriginalFirstThunk`) are
+// usable: without one, the names in `FirstThunk` were overwritten by the
+// addresses. Imports by ordinal are skipped. Forwarded exports resolve to
+// their final target, as the loader followed the forwarder already.
+//
+
+template <typename F, typename C>
+__forceinline
+F scavenge_symbol_impl(void* source, uint32_t module_hash, C comparator) {
+    if (!source) {
+        return nullptr;
+    }
+
+    pe::unchecked_image_view Image{ source };
+
+    for (auto Import : Image.imports()) {
+        if (!Import.descriptor->OriginalFirstThunk || fnv1a_hash(Import.name) != module_hash) {
+            continue;
+        }
+
+        auto Address = Import.addresses().begin();
+        for (auto& Thunk : Import.names()) {
+            auto ByName = Import.by_name(Thunk);
+            if (ByName && comparator(ByName->Name)) {
+                return reinterpret_cast<F>(static_cast<uintptr_t>(Address->u1.Function));
+            }
+            ++Address;
+        }
+    }
+
+    return nullptr;
+}
+
+template <typename F>
+F scavenge_symbol(void* source, uint32_t module_hash, const char* name) {
+    return scavenge_symbol_impl<F>(source, module_hash, [name](const char* import_name) {
+        return strcmp(import_name, name) == 0;
+    });
+}
+
+template <typename F>
+F scavenge_symbol(void* source, uint32_t module_hash, uint32_t hash) {
+    return scavenge_symbol_impl<F>(source, module_hash, [hash](const char* import_name) {
+        return fnv1a_hash(import_name) == hash;
     });
 }
 
@@ -174,8 +253,8 @@ namespace usermode {
 //          | BaseDllName |    | BaseDllName |    | BaseDllName |
 //          +-------------+    +-------------+    +-------------+
 //
-//   `ntdll.dll` is always second (after exe), `kernel32.dll` third.
-//   `find_module_ntdll()` and `find_module_kernel32()` exploit this.
+//   `ntdll.dll` is normally second (after the exe), `kernel32.dll` third.
+//   `find_module_hinted()` exploits this (see "Positional hints" below).
 //
 
 template <typename F>
@@ -213,23 +292,129 @@ void* find_module(uint32_t hash) {
 }
 
 //
-// Fast path: `ntdll.dll` is always the second entry in `InLoadOrderModuleList`
-// (first is the exe itself). Skip straight to it instead of searching.
+// Forwarder resolver: matches the module name up to its extension
+// (see `module_stem_hash()`).
 //
 
 __forceinline
-void* find_module_ntdll() {
-    return ((PLDR_DATA_TABLE_ENTRY)NtCurrentPeb()->Ldr->InLoadOrderModuleList.Flink->Flink)->DllBase;
+void* find_module_stem(uint32_t hash) {
+    return find_module_impl([hash](const wchar_t* module) {
+        return module_stem_hash(module) == hash;
+    });
+}
+
+//
+// Positional hints.
+//
+// Most lookups are for modules that sit at a fixed position in
+// `InLoadOrderModuleList`: the loader maps `ntdll.dll` right after the exe
+// and `kernel32.dll` right after that. A hint names a module and its
+// expected position (0 is the exe); `find_module_hinted()` hops straight
+// to that entry, checks its name and only walks the list if it is some
+// other module. A wrong hint costs one name comparison, never a wrong
+// module.
+//
+// Additional hints for a known target environment are declared before
+// including `usermode.h` and are tried before the defaults:
+//
+//   // x64 emulation on ARM64: xtajit64.dll is loaded ahead of kernel32.dll.
+//   #define SCFW_MODULE_HINTS SCFW_MODULE_HINT("kernel32.dll", 3)
+//
+// Hints are matched against the (constant) module name or hash at compile
+// time, so a lookup only carries the checks of its own module's hints.
+//
+
+struct module_hint {
+    constexpr module_hint(const char* name, uint32_t position)
+        : name(name)
+        , hash(fnv1a_hash(name))
+        , position(position)
+    {}
+
+    const char* name;
+    uint32_t hash;
+    uint32_t position;
+};
+
+#define SCFW_MODULE_HINT(Name, Position) \
+    ::sc::detail::windows::usermode::module_hint{ Name, Position },
+
+#ifndef SCFW_MODULE_HINTS
+#   define SCFW_MODULE_HINTS
+#endif
+
+inline constexpr module_hint module_hints[] = {
+    SCFW_MODULE_HINTS
+    SCFW_MODULE_HINT("ntdll.dll", 1)
+    SCFW_MODULE_HINT("kernel32.dll", 2)
+};
+
+//
+// Module at `position` in `InLoadOrderModuleList`, if `comparator` accepts
+// its name; `nullptr` otherwise (or if the list is shorter).
+//
+
+template <typename F>
+__forceinline
+void* find_module_at(uint32_t position, F comparator) {
+    PLIST_ENTRY Head = &NtCurrentPeb()->Ldr->InLoadOrderModuleList;
+    PLIST_ENTRY Entry = Head;
+    for (uint32_t Index = 0; Index <= position; Index++) {
+        Entry = Entry->Flink;
+        if (Entry == Head) {
+            return nullptr;
+        }
+    }
+
+    PLDR_DATA_TABLE_ENTRY Ldr = (PLDR_DATA_TABLE_ENTRY)Entry;
+    return comparator(Ldr->BaseDllName.Buffer) ? Ldr->DllBase : nullptr;
+}
+
+template <typename H, typename F, size_t... Index>
+__forceinline
+void* find_module_hinted_impl(H hinted, F comparator, std::index_sequence<Index...>) {
+    void* Module = nullptr;
+    ((hinted(module_hints[Index]) &&
+        (Module = find_module_at(module_hints[Index].position, comparator))) || ...);
+    return Module ? Module : find_module_impl(comparator);
 }
 
 //
-// Fast path: `kernel32.dll` is always the third entry in `InLoadOrderModuleList`
-// (exe -> ntdll -> kernel32). Three Flink hops from the list head.
+// `find_module()` with the positional hints tried first.
 //
 
+__forceinline
+void* find_module_hinted(const char* name) {
+    return find_module_hinted_impl(
+        [name](const module_hint& hint) {
+            return _stricmp(name, hint.name) == 0;
+        },
+        [name](const wchar_t* module) {
+            return _wcsicmpa(module, name) == 0;
+        },
+        std::make_index_sequence<std::size(module_hints)>{});
+}
+
+__forceinline
+void* find_module_hinted(uint32_t hash) {
+    return find_module_hinted_impl(
+        [hash](const module_hint& hint) {
+            return hash == hint.hash;
+        },
+        [hash](const wchar_t* module) {
+            return fnv1a_hash(module) == hash;
+        },
+        std::make_index_sequence<std::size(module_hints)>{});
+}
+
+__forceinline
+void* find_module_ntdll() {
+    return find_module_hinted(fnv1a_hash("ntdll.dll"));
+}
+
 __forceinline
 void* find_module_kernel32() {
-    return ((PLDR_DATA_TABLE_ENTRY)NtCurrentPeb()->Ldr->InLoadOrderModuleList.Flink->Flink->Flink)->DllBase;
+    return find_module_hinted(fnv1a_hash("kernel32.dll"));
 }
 
 } // namespace usermode
@@ -270,61 +455,307 @@ MmGetSystemRoutineAddress (
     _In_ PUNICODE_STRING SystemRoutineName
     );
 
+typedef
+VOID
+NTAPI
+KSTART_ROUTINE (
+    _In_ PVOID StartContext
+    );
+typedef KSTART_ROUTINE *PKSTART_ROUTINE;
+
+_IRQL_requires_max_(PASSIVE_LEVEL)
+NTKERNELAPI
+NTSTATUS
+NTAPI
+PsCreateSystemThread (
+    _Out_ PHANDLE ThreadHandle,
+    _In_ ULONG DesiredAccess,
+    _In_opt_ POBJECT_ATTRIBUTES ObjectAttributes,
+    _In_opt_ HANDLE ProcessHandle,
+    _Out_opt_ PCLIENT_ID ClientId,
+    _In_ PKSTART_ROUTINE StartRoutine,
+    _In_opt_ _When_(return >= 0, __drv_aliasesMem) PVOID StartContext
+    );
+
+typedef
+VOID
+NTAPI
+KDEFERRED_ROUTINE (
+    _In_ struct _KDPC* Dpc,
+    _In_opt_ PVOID DeferredContext,
+    _In_opt_ PVOID SystemArgument1,
+    _In_opt_ PVOID SystemArgument2
+    );
+typedef KDEFERRED_ROUTINE *PKDEFERRED_ROUTINE;
+
+_IRQL_requires_max_(APC_LEVEL)
+NTKERNELAPI
+VOID
+NTAPI
+KeGenericCallDpc (
+    _In_ PKDEFERRED_ROUTINE Routine,
+    _In_opt_ PVOID Context
+    );
+
+_IRQL_requires_(DISPATCH_LEVEL)
+NTKERNELAPI
+VOID
+NTAPI
+KeSignalCallDpcDone (
+    _In_ PVOID SystemArgument1
+    );
+
+_IRQL_requires_(DISPATCH_LEVEL)
+NTKERNELAPI
+LOGICAL
+NTAPI
+KeSignalCallDpcSynchronize (
+    _In_ PVOID SystemArgument2
+    );
+
+_IRQL_requires_max_(PASSIVE_LEVEL)
+NTKERNELAPI
+VOID
+NTAPI
+KeFlushQueuedDpcs (
+    VOID
+    );
+
+NTKERNELAPI
+ULONG
+NTAPI
+KeQueryActiveProcessorCountEx (
+    _In_ USHORT GroupNumber
+    );
+
+NTKERNELAPI
+ULONG
+NTAPI
+KeGetCurrentProcessorNumberEx (
+    _Out_opt_ PPROCESSOR_NUMBER ProcNumber
+    );
+
+typedef struct _MDL* PMDL;
+
+typedef enum _LOCK_OPERATION {
+    IoReadAccess,
+    IoWriteAccess,
+    IoModifyAccess
+} LOCK_OPERATION;
+
+//
+// Only the size matters to us; the trailing flag bytes differ between
+// builds but always fit in the padding.
+//
+
+typedef struct _KAPC_STATE {
+    LIST_ENTRY ApcListHead[2];
+    PVOID Process;
+    UCHAR Flags[4];
+} KAPC_STATE, *PKAPC_STATE;
+
+_IRQL_requires_max_(DISPATCH_LEVEL)
+NTKERNELAPI
+PMDL
+NTAPI
+IoAllocateMdl (
+    _In_opt_ __drv_aliasesMem PVOID VirtualAddress,
+    _In_ ULONG Length,
+    _In_ BOOLEAN SecondaryBuffer,
+    _In_ BOOLEAN ChargeQuota,
+    _Inout_opt_ PVOID Irp
+    );
+
+_IRQL_requires_max_(DISPATCH_LEVEL)
+NTKERNELAPI
+VOID
+NTAPI
+IoFreeMdl (
+    PMDL Mdl
+    );
+
+_IRQL_requires_max_(DISPATCH_LEVEL)
+NTKERNELAPI
+VOID
+NTAPI
+MmProbeAndLockPages (
+    _Inout_ PMDL MemoryDescriptorList,
+    _In_ CCHAR AccessMode,
+    _In_ LOCK_OPERATION Operation
+    );
+
+_IRQL_requires_max_(DISPATCH_LEVEL)
+NTKERNELAPI
+VOID
+NTAPI
+MmUnlockPages (
+    _Inout_ PMDL MemoryDescriptorList
+    );
+
+_IRQL_requires_max_(DISPATCH_LEVEL)
+NTKERNELAPI
+PVOID
+NTAPI
+MmMapLockedPagesSpecifyCache (
+    _Inout_ PMDL MemoryDescriptorList,
+    _In_ CCHAR AccessMode,
+    _In_ ULONG CacheType,
+    _In_opt_ PVOID RequestedAddress,
+    _In_ ULONG BugCheckOnFailure,
+    _In_ ULONG Priority
+    );
+
+_IRQL_requires_max_(DISPATCH_LEVEL)
+NTKERNELAPI
+VOID
+NTAPI
+MmUnmapLockedPages (
+    _In_ PVOID BaseAddress,
+    _Inout_ PMDL MemoryDescriptorList
+    );
+
+_IRQL_requires_max_(APC_LEVEL)
+NTKERNELAPI
+HANDLE
+NTAPI
+MmSecureVirtualMemory (
+    _In_ PVOID Address,
+    _In_ __in_data_source(USER_MODE) SIZE_T Size,
+    _In_ ULONG ProbeMode
+    );
+
+_IRQL_requires_max_(APC_LEVEL)
+NTKERNELAPI
+VOID
+NTAPI
+MmUnsecureVirtualMemory (
+    _In_ HANDLE SecureHandle
+    );
+
+_IRQL_requires_max_(APC_LEVEL)
+NTKERNELAPI
+VOID
+NTAPI
+KeStackAttachProcess (
+    _Inout_ PVOID Process,
+    _Out_ PKAPC_STATE ApcState
+    );
+
+_IRQL_requires_max_(APC_LEVEL)
+NTKERNELAPI
+VOID
+NTAPI
+KeUnstackDetachProcess (
+    _In_ PKAPC_STATE ApcState
+    );
+
 }
 
-template <typename F>
-void* find_module_impl(void* kernel_base, F comparator) {
+//
+// Snapshot of the loaded kernel modules (`SystemModuleInformation`).
+//
+// Querying the module list means three export lookups in ntoskrnl, a pool
+// allocation and a walk over every loaded driver, so kernel-mode init
+// takes one snapshot up front and resolves all `IMPORT_MODULE`s and
+// forwarded exports against it (see `mode_traits<kernel_mode>`).
+//
+// Plain aggregate, so it can live in the dispatch table (or the init
+// context). `take()` must be called at PASSIVE_LEVEL.
+//
+
+struct module_snapshot {
+    NTSTATUS take(void* kernel_base) {
 #ifdef SCFW_ENABLE_INIT_SYMBOLS_BY_STRING
 #   define SCFW__SYMBOL(x) _(x)
 #else
 #   define SCFW__SYMBOL(x) fnv1a_hash(x)
 #endif
 
-    auto pExAllocatePool = lookup_symbol<decltype(&ExAllocatePool)>(
-        kernel_base, SCFW__SYMBOL("ExAllocatePool"));
-    auto pExFreePool = lookup_symbol<decltype(&ExFreePool)>(
-        kernel_base, SCFW__SYMBOL("ExFreePool"));
-    auto pZwQuerySystemInformation = lookup_symbol<decltype(&ZwQuerySystemInformation)>(
-        kernel_base, SCFW__SYMBOL("ZwQuerySystemInformation"));
+        auto pExAllocatePool = lookup_symbol<decltype(&ExAllocatePool)>(
+            kernel_base, SCFW__SYMBOL("ExAllocatePool"));
+        auto pZwQuerySystemInformation = lookup_symbol<decltype(&ZwQuerySystemInformation)>(
+            kernel_base, SCFW__SYMBOL("ZwQuerySystemInformation"));
+
+        free_pool = lookup_symbol<decltype(&ExFreePool)>(
+            kernel_base, SCFW__SYMBOL("ExFreePool"));
 
 #undef SCFW__SYMBOL
 
-    NTSTATUS Status;
-    PVOID Result = nullptr;
-    PVOID Buffer = nullptr;
-    ULONG BufferLength = 0;
-    ULONG RequiredLength = 0;
+        NTSTATUS Status;
+        PVOID Buffer = nullptr;
+        ULONG BufferLength = 0;
+        ULONG RequiredLength = 0;
 
-    do
-    {
-        if (RequiredLength) {
-            if (Buffer) {
-                pExFreePool(Buffer);
+        do
+        {
+            if (RequiredLength) {
+                if (Buffer) {
+                    free_pool(Buffer);
+                }
+
+                Buffer = pExAllocatePool(NonPagedPool, RequiredLength);
+                if (!Buffer) {
+                    return STATUS_INSUFFICIENT_RESOURCES;
+                }
+
+                BufferLength = RequiredLength;
             }
 
-            Buffer = pExAllocatePool(NonPagedPool, RequiredLength);
-            BufferLength = RequiredLength;
+            Status = pZwQuerySystemInformation(SystemModuleInformation,
+                                               Buffer,
+                                               BufferLength,
+                                               &RequiredLength);
+
+        } while (Status == STATUS_INFO_LENGTH_MISMATCH);
+
+        if (!NT_SUCCESS(Status)) {
+            if (Buffer) {
+                free_pool(Buffer);
+            }
+            return Status;
         }
 
-        Status = pZwQuerySystemInformation(SystemModuleInformation,
-                                           Buffer,
-                                           BufferLength,
-                                           &RequiredLength);
+        modules = (PRTL_PROCESS_MODULES)Buffer;
+        return STATUS_SUCCESS;
+    }
 
-    } while (Status == STATUS_INFO_LENGTH_MISMATCH);
+    void release() {
+        if (modules) {
+            free_pool(modules);
+            modules = nullptr;
+        }
+    }
 
-    PRTL_PROCESS_MODULES Modules = (PRTL_PROCESS_MODULES)Buffer;
-    for (ULONG Index = 0; Index < Modules->NumberOfModules; Index++) {
-        PRTL_PROCESS_MODULE_INFORMATION ModuleInfo = &Modules->Modules[Index];
+    template <typename F>
+    void* find(F comparator) const {
+        for (ULONG Index = 0; Index < modules->NumberOfModules; Index++) {
+            PRTL_PROCESS_MODULE_INFORMATION ModuleInfo = &modules->Modules[Index];
 
-        PCHAR ModuleName = (PCHAR)ModuleInfo->FullPathName + ModuleInfo->OffsetToFileName;
-        if (comparator(ModuleName)) {
-            Result = ModuleInfo->ImageBase;
-            break;
+            PCHAR ModuleName = (PCHAR)ModuleInfo->FullPathName + ModuleInfo->OffsetToFileName;
+            if (comparator(ModuleName)) {
+                return ModuleInfo->ImageBase;
+            }
         }
+        return nullptr;
+    }
+
+    PRTL_PROCESS_MODULES modules;
+    decltype(&ExFreePool) free_pool;
+};
+
+//
+// One-shot lookup: takes a snapshot, searches it and frees it again.
+//
+
+template <typename F>
+void* find_module_impl(void* kernel_base, F comparator) {
+    module_snapshot Snapshot{};
+    if (!NT_SUCCESS(Snapshot.take(kernel_base))) {
+        return nullptr;
     }
 
-    pExFreePool(Buffer);
+    void* Result = Snapshot.find(comparator);
+    Snapshot.release();
     return Result;
 }
 
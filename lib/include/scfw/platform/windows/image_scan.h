@@ -0,0 +1,93 @@
+#pragma once
+
+//
+// Signature scanning over the code of a loaded PE image.
+//
+// Scans only the executable sections (`IMAGE_SCN_MEM_EXECUTE`) of a module
+// mapped in memory, skipping headers, data and resources - usually a
+// fraction of the image. Discardable sections (`INIT` in drivers) are
+// skipped too; the kernel frees them after the driver is loaded.
+//
+//   auto Ntdll = sc::detail::windows::usermode::find_module_ntdll();
+//   auto Match = sc::scan_image_first(Ntdll, sc::pattern{ "4C 8B D1 B8 ?? ?? 00 00" });
+//
+// The headers are bounds-checked (`pe::image_view`); an image with invalid
+// headers has no sections to scan. Matches spanning two sections are not
+// reported. See `runtime/scan.h` for the pattern syntax.
+//
+
+#include "../../runtime/scan.h"
+#include "common.h"
+
+namespace sc {
+namespace detail {
+
+//
+// Calls `fn(std::span<const uint8_t>)` for every executable section of
+// `image` until it returns `false`.
+//
+
+template <typename F>
+void for_each_code_section(void* image, F&& fn) {
+    pe::image_view Image{ image };
+
+    for (auto& Section : Image.sections()) {
+        if ((Section.Characteristics & IMAGE_SCN_MEM_EXECUTE) == 0 ||
+            (Section.Characteristics & IMAGE_SCN_MEM_DISCARDABLE) != 0) {
+            continue;
+        }
+
+        if (!fn(Image.section_data(Section))) {
+            return;
+        }
+    }
+}
+
+} // namespace detail
+
+//
+// `sc::scan()` over every executable section of `image`.
+//
+
+template <size_t N, typename F>
+size_t scan_image(void* image, const pattern<N>& pat, F&& fn) {
+    size_t Count = 0;
+
+    auto Callback = [&](const uint8_t* match) {
+        Count++;
+        if constexpr (std::is_void_v<std::invoke_result_t<F&, const uint8_t*>>) {
+            fn(match);
+            return true;
+        } else {
+            return static_cast<bool>(fn(match));
+        }
+    };
+
+    detail::for_each_code_section(image, [&](std::span<const uint8_t> section) {
+        return detail::scan(section, pat, Callback);
+    });
+
+    return Count;
+}
+
+//
+// First match in the executable sections of `image`, or `nullptr`.
+//
+
+template <size_t N>
+const uint8_t* scan_image_first(void* image, const pattern<N>& pat) {
+    const uint8_t* Result = nullptr;
+
+    auto Callback = [&](const uint8_t* match) {
+        Result = match;
+        return false;
+    };
+
+    detail::for_each_code_section(image, [&](std::span<const uint8_t> section) {
+        return detail::scan(section, pat, Callback);
+    });
+
+    return Result;
+}
+
+} // namespace sc
@@ -5,8 +5,10 @@
 //
 // Specializes the dispatch table base class for kernel-mode shellcode.
 // Module resolution uses `ZwQuerySystemInformation(SystemModuleInformation)`
-// instead of walking the PEB. Symbol resolution reuses the same PE export
-// parser as usermode (`lookup_symbol` in `common.h`).
+// instead of walking the PEB: the base init takes one snapshot of the module
+// list, every `IMPORT_MODULE` is resolved against it, and it is freed again
+// right after init. Symbol resolution reuses the same PE export parser as
+// usermode (`lookup_symbol` in `common.h`).
 //
 // Dynamic module loading and dynamic symbol lookup are not available in
 // kernel mode and will trigger a `static_assert` if enabled.
@@ -15,6 +17,39 @@
 //      loading from arbitrary modules, it would not be very useful for our
 //      purposes.
 //
+//=============================================================================
+// KERNELMODE-SPECIFIC OPTIONS
+//=============================================================================
+//
+//   SCFW_ENABLE_FIND_MODULE_FORWARDER
+//     Same as in usermode: follows forwarded exports. Target modules
+//     ("NTOSKRNL", "HAL", "ext-ms-win-...") are looked up in the module
+//     snapshot by the hash of their name without extension. API-set names
+//     only resolve if a module of that name is actually loaded.
+//
+//   SCFW_ENABLE_FOR_EACH_CPU
+//     Resolves `KeGenericCallDpc`, `KeSignalCallDpcSynchronize`,
+//     `KeSignalCallDpcDone`, `KeFlushQueuedDpcs`,
+//     `KeQueryActiveProcessorCountEx` and `KeGetCurrentProcessorNumberEx`
+//     from ntoskrnl at init time. Required by `sc::kernel::for_each_cpu`
+//     (`kernelmode/for_each_cpu.h`).
+//
+//   SCFW_ENABLE_USER_MAPPING
+//     Resolves the MDL functions (`IoAllocateMdl`, `MmProbeAndLockPages`,
+//     `MmMapLockedPagesSpecifyCache`, ...) plus `MmSecureVirtualMemory`
+//     and `KeStackAttachProcess` from ntoskrnl at init time. Required by
+//     `sc::kernel::user_mapping` (`kernelmode/user_mapping.h`).
+//
+//   SCFW_ENABLE_SYSTEM_SNAPSHOT
+//     Resolves `ZwQuerySystemInformation` from ntoskrnl at init time.
+//     Required by `sc::system_snapshot` (`system_snapshot.h`).
+//
+//   SCFW_ENABLE_SCAVENGE_IAT
+//     `SCFW_FLAG_SCAVENGE_IAT` entries are read from the import table of
+//     ntoskrnl (which imports from HAL, CI, kdcom, ...), or of the loaded
+//     module named by `SCFW_SCAVENGE_IAT_MODULE` (e.g. "tcpip.sys" for
+//     NETIO/NDIS imports).
+//
 
 #include "common.h"
 #include "../../runtime.h"
@@ -57,34 +92,178 @@ struct mode_traits<kernel_mode> {
     static_assert(false, "Dynamic symbol lookup is not supported in kernel mode");
     using lookup_symbol_fn = void;
 #endif
+#ifdef SCFW_ENABLE_DETACH
+    struct detach_api {
+        decltype(&windows::kernelmode::PsCreateSystemThread) PsCreateSystemThread;
+        decltype(&::ZwCreateEvent) ZwCreateEvent;
+        decltype(&::ZwSetEvent) ZwSetEvent;
+        decltype(&::ZwWaitForSingleObject) ZwWaitForSingleObject;
+        decltype(&::ZwClose) ZwClose;
+    };
+#endif
+#ifdef SCFW_ENABLE_FOR_EACH_CPU
+    struct for_each_cpu_api {
+        decltype(&windows::kernelmode::KeGenericCallDpc) KeGenericCallDpc;
+        decltype(&windows::kernelmode::KeSignalCallDpcDone) KeSignalCallDpcDone;
+        decltype(&windows::kernelmode::KeSignalCallDpcSynchronize) KeSignalCallDpcSynchronize;
+        decltype(&windows::kernelmode::KeFlushQueuedDpcs) KeFlushQueuedDpcs;
+        decltype(&windows::kernelmode::KeQueryActiveProcessorCountEx) KeQueryActiveProcessorCountEx;
+        decltype(&windows::kernelmode::KeGetCurrentProcessorNumberEx) KeGetCurrentProcessorNumberEx;
+    };
+#endif
+#ifdef SCFW_ENABLE_USER_MAPPING
+    struct user_mapping_api {
+        decltype(&windows::kernelmode::IoAllocateMdl) IoAllocateMdl;
+        decltype(&windows::kernelmode::IoFreeMdl) IoFreeMdl;
+        decltype(&windows::kernelmode::MmProbeAndLockPages) MmProbeAndLockPages;
+        decltype(&windows::kernelmode::MmUnlockPages) MmUnlockPages;
+        decltype(&windows::kernelmode::MmMapLockedPagesSpecifyCache) MmMapLockedPagesSpecifyCache;
+        decltype(&windows::kernelmode::MmUnmapLockedPages) MmUnmapLockedPages;
+        decltype(&windows::kernelmode::MmSecureVirtualMemory) MmSecureVirtualMemory;
+        decltype(&windows::kernelmode::MmUnsecureVirtualMemory) MmUnsecureVirtualMemory;
+        decltype(&windows::kernelmode::KeStackAttachProcess) KeStackAttachProcess;
+        decltype(&windows::kernelmode::KeUnstackDetachProcess) KeUnstackDetachProcess;
+    };
+#endif
+#ifdef SCFW_ENABLE_SYSTEM_SNAPSHOT
+    struct system_snapshot_api {
+        decltype(&::ZwQuerySystemInformation) QuerySystemInformation;
+    };
+#endif
+#ifdef SCFW_ENABLE_MAPPED_FILE
+    static_assert(false, "mapped_file is not supported in kernel mode");
+    using mapped_file_api = void;
+#endif
+#ifdef SCFW_ENABLE_ASYNC_IO
+    static_assert(false, "async_io is not supported in kernel mode");
+    using async_io_api = void;
+#endif
+#ifdef SCFW_ENABLE_PARALLEL_FOR
+    static_assert(false, "parallel_for is not supported in kernel mode");
+    using parallel_for_api = void;
+#endif
+#ifdef SCFW_ENABLE_WAIT_ON_ADDRESS
+    static_assert(false, "wait_on_address is not supported in kernel mode");
+    using wait_on_address_api = void;
+#endif
+#ifdef SCFW_ENABLE_INIT_CONTEXT
+    struct init_state {
+        windows::kernelmode::module_snapshot modules;
+    };
+#endif
+
+    //
+    // Module lookups go through the snapshot taken by the base init. Once
+    // it has been released (after init), each lookup queries the module
+    // list on its own. With `SCFW_ENABLE_INIT_CONTEXT`, the snapshot is in
+    // the init context on `_entry`'s stack and `modules` points to it
+    // while `init()` runs.
+    //
 
     void* find_module(const char* name) const {
         if (_stricmp(name, "ntoskrnl.exe") == 0) {
             return kernel_base;
         }
-        return windows::kernelmode::find_module(kernel_base, name);
+        return find_loaded_module([name](const char* module_name) {
+            return _stricmp(module_name, name) == 0;
+        });
     }
 
     void* find_module(uint32_t hash) const {
         if (hash == fnv1a_hash("ntoskrnl.exe")) {
             return kernel_base;
         }
-        return windows::kernelmode::find_module(kernel_base, hash);
+        return find_loaded_module([hash](const char* module_name) {
+            return fnv1a_hash(module_name) == hash;
+        });
+    }
+
+    //
+    // Forwarder resolver. Forward strings name modules without extension
+    // ("NTOSKRNL.ExAllocatePool", "HAL.KeQueryPerformanceCounter"). The
+    // kernel may be loaded as ntkrnlmp.exe/ntkrla57.exe, but is always
+    // referred to as "ntoskrnl".
+    //
+
+    void* find_forwarder_module(uint32_t hash) const {
+        if (hash == fnv1a_hash("ntoskrnl")) {
+            return kernel_base;
+        }
+        return find_loaded_module([hash](const char* module_name) {
+            return windows::module_stem_hash(module_name) == hash;
+        });
     }
 
     template <typename F>
-    static F lookup_symbol(void* module, const char* name) {
-        return windows::lookup_symbol<F>(module, name);
+    void* find_loaded_module(F comparator) const {
+#ifdef SCFW_ENABLE_INIT_CONTEXT
+        if (modules) {
+            return modules->find(comparator);
+        }
+#else
+        if (modules.modules) {
+            return modules.find(comparator);
+        }
+#endif
+        return windows::kernelmode::find_module_impl(kernel_base, comparator);
+    }
+
+    template <typename F>
+    static F lookup_symbol(void* module, const char* name);
+
+    template <typename F>
+    static F lookup_symbol(void* module, uint32_t hash);
+
+    static bool image_matches(void* module, uint32_t time_date_stamp, uint32_t size_of_image) {
+        return windows::image_matches(module, time_date_stamp, size_of_image);
+    }
+
+    template <typename F>
+    static F scavenge_symbol(void* source, uint32_t module_hash, const char* name) {
+        return windows::scavenge_symbol<F>(source, module_hash, name);
     }
 
     template <typename F>
-    static F lookup_symbol(void* module, uint32_t hash) {
-        return windows::lookup_symbol<F>(module, hash);
+    static F scavenge_symbol(void* source, uint32_t module_hash, uint32_t hash) {
+        return windows::scavenge_symbol<F>(source, module_hash, hash);
     }
 
     void* kernel_base;
+#ifdef SCFW_ENABLE_INIT_CONTEXT
+    const windows::kernelmode::module_snapshot* modules;
+#else
+    windows::kernelmode::module_snapshot modules;
+#endif
 };
 
+//
+// Defined out of line: with forwarders enabled, they reach the module
+// snapshot through the dispatch table, which needs a complete
+// `mode_traits<kernel_mode>`.
+//
+
+template <typename F>
+F mode_traits<kernel_mode>::lookup_symbol(void* module, const char* name) {
+#ifdef SCFW_ENABLE_FIND_MODULE_FORWARDER
+    return windows::lookup_symbol<F>(module, name, [](uint32_t module_hash) {
+        return base_table<kernel_mode>()->mode_state().find_forwarder_module(module_hash);
+    });
+#else
+    return windows::lookup_symbol<F>(module, name);
+#endif
+}
+
+template <typename F>
+F mode_traits<kernel_mode>::lookup_symbol(void* module, uint32_t hash) {
+#ifdef SCFW_ENABLE_FIND_MODULE_FORWARDER
+    return windows::lookup_symbol<F>(module, hash, [](uint32_t module_hash) {
+        return base_table<kernel_mode>()->mode_state().find_forwarder_module(module_hash);
+    });
+#else
+    return windows::lookup_symbol<F>(module, hash);
+#endif
+}
+
 //
 // Kernel-mode init. `argument1` is the ntoskrnl base address,
 // used to bootstrap symbol resolution.
@@ -92,10 +271,28 @@ struct mode_traits<kernel_mode> {
 
 template<>
 __forceinline
-int dispatch_table_impl<0, kernel_mode>::init(void* argument1, void* argument2) {
+int dispatch_table_impl<0, kernel_mode>::init(init_context<kernel_mode>& context,
+                                              void* argument1,
+                                              void* argument2) {
+    (void)context;
     (void)argument2;
     void* kernel_base = argument1;
 
+    //
+    // Snapshot the module list once for all `IMPORT_MODULE` entries and
+    // forwarded exports; released again by `finish_init()`. If it cannot
+    // be taken, every lookup queries the module list itself.
+    //
+
+    this->mode_.kernel_base = kernel_base;
+#ifdef SCFW_ENABLE_INIT_CONTEXT
+    if (NT_SUCCESS(context.mode_state.modules.take(kernel_base))) {
+        this->mode_.modules = &context.mode_state.modules;
+    }
+#else
+    this->mode_.modules.take(kernel_base);
+#endif
+
 #ifdef SCFW_ENABLE_INIT_SYMBOLS_BY_STRING
 #   define SCFW__SYMBOL(x) _(x)
 #else
@@ -107,11 +304,78 @@ int dispatch_table_impl<0, kernel_mode>::init(void* argument1, void* argument2)
     this->free_ = mode::lookup_symbol<typename mode::free_fn>(kernel_base, SCFW__SYMBOL("ExFreePool"));
 #endif
 
-    this->mode_.kernel_base = kernel_base;
+    //
+    // Kernel API used by detached execution and the framework helpers
+    // (`platform/windows/kernelmode/*.h`). All of it lives in ntoskrnl.
+    //
+
+#define SCFW__RESOLVE(api, name)                                              \
+    api.name = mode::lookup_symbol<decltype(api.name)>(kernel_base, SCFW__SYMBOL(#name))
+
+#ifdef SCFW_ENABLE_DETACH
+    SCFW__RESOLVE(this->detach_, PsCreateSystemThread);
+    SCFW__RESOLVE(this->detach_, ZwCreateEvent);
+    SCFW__RESOLVE(this->detach_, ZwSetEvent);
+    SCFW__RESOLVE(this->detach_, ZwWaitForSingleObject);
+    SCFW__RESOLVE(this->detach_, ZwClose);
+#endif
+#ifdef SCFW_ENABLE_FOR_EACH_CPU
+    SCFW__RESOLVE(this->for_each_cpu_, KeGenericCallDpc);
+    SCFW__RESOLVE(this->for_each_cpu_, KeSignalCallDpcDone);
+    SCFW__RESOLVE(this->for_each_cpu_, KeSignalCallDpcSynchronize);
+    SCFW__RESOLVE(this->for_each_cpu_, KeFlushQueuedDpcs);
+    SCFW__RESOLVE(this->for_each_cpu_, KeQueryActiveProcessorCountEx);
+    SCFW__RESOLVE(this->for_each_cpu_, KeGetCurrentProcessorNumberEx);
+#endif
+#ifdef SCFW_ENABLE_USER_MAPPING
+    SCFW__RESOLVE(this->user_mapping_, IoAllocateMdl);
+    SCFW__RESOLVE(this->user_mapping_, IoFreeMdl);
+    SCFW__RESOLVE(this->user_mapping_, MmProbeAndLockPages);
+    SCFW__RESOLVE(this->user_mapping_, MmUnlockPages);
+    SCFW__RESOLVE(this->user_mapping_, MmMapLockedPagesSpecifyCache);
+    SCFW__RESOLVE(this->user_mapping_, MmUnmapLockedPages);
+    SCFW__RESOLVE(this->user_mapping_, MmSecureVirtualMemory);
+    SCFW__RESOLVE(this->user_mapping_, MmUnsecureVirtualMemory);
+    SCFW__RESOLVE(this->user_mapping_, KeStackAttachProcess);
+    SCFW__RESOLVE(this->user_mapping_, KeUnstackDetachProcess);
+#endif
+#ifdef SCFW_ENABLE_SYSTEM_SNAPSHOT
+    //
+    // The `Zw` variant: `Nt` would probe the buffer as a user-mode one
+    // when called on behalf of a user thread.
+    //
+
+    this->system_snapshot_.QuerySystemInformation =
+        mode::lookup_symbol<decltype(this->system_snapshot_.QuerySystemInformation)>(
+            kernel_base, SCFW__SYMBOL("ZwQuerySystemInformation"));
+#endif
+
+#ifdef SCFW_ENABLE_SCAVENGE_IAT
+#   ifdef SCFW_SCAVENGE_IAT_MODULE
+    this->set_iat_source(context,
+                         this->mode_.find_module(fnv1a_hash(SCFW_SCAVENGE_IAT_MODULE)));
+#   else
+    this->set_iat_source(context, kernel_base);
+#   endif
+#endif
+
+#undef SCFW__RESOLVE
 
     return 0;
 }
 
+template<>
+__forceinline
+void dispatch_table_impl<0, kernel_mode>::finish_init(init_context<kernel_mode>& context) {
+#ifdef SCFW_ENABLE_INIT_CONTEXT
+    context.mode_state.modules.release();
+    this->mode_.modules = nullptr;
+#else
+    (void)context;
+    this->mode_.modules.release();
+#endif
+}
+
 template<>
 __forceinline
 void dispatch_table_impl<0, kernel_mode>::destroy(void* argument1, void* argument2) {
@@ -119,6 +383,69 @@ void dispatch_table_impl<0, kernel_mode>::destroy(void* argument1, void* argumen
     (void)argument2;
 }
 
+#ifdef SCFW_ENABLE_DETACH
+template<>
+__forceinline
+int dispatch_table_impl<0, kernel_mode>::detach(void* argument1, void* argument2) {
+    //
+    // Must be called at PASSIVE_LEVEL. The system thread starts at
+    // `_start_thread`; with cleanup enabled it frees the shellcode through
+    // `_start` -> `_cleanup_kernelmode` once `entry()` returns, so it must
+    // not get going before the caller's thread is out of the shellcode.
+    // System threads can't be created suspended: the thread waits for an
+    // event in `enter_detached()` instead, which `_detach` sets with a
+    // tail-jump to `ZwSetEvent`. The event is a handle rather than a KEVENT
+    // in the dispatch table, so `ZwSetEvent` holds its own reference while
+    // the thread goes on to free the shellcode.
+    //
+
+    this->detach_argument1_ = argument1;
+    this->detach_argument2_ = argument2;
+
+    OBJECT_ATTRIBUTES ObjectAttributes;
+    InitializeObjectAttributes(&ObjectAttributes, NULL, OBJ_KERNEL_HANDLE, NULL, NULL);
+
+    HANDLE Event;
+    NTSTATUS Status = this->detach_.ZwCreateEvent(
+        &Event,
+        EVENT_ALL_ACCESS,
+        &ObjectAttributes,
+        NotificationEvent,
+        FALSE);
+
+    if (!NT_SUCCESS(Status)) {
+        return Status;
+    }
+
+    this->detach_release_.routine = reinterpret_cast<void*>(this->detach_.ZwSetEvent);
+    this->detach_release_.handle = Event;
+
+    HANDLE Thread;
+    Status = this->detach_.PsCreateSystemThread(
+        &Thread,
+        THREAD_ALL_ACCESS,
+        &ObjectAttributes,
+        NULL,
+        NULL,
+        reinterpret_cast<windows::kernelmode::PKSTART_ROUTINE>(_(&::_start_thread)),
+        NULL);
+
+    if (!NT_SUCCESS(Status)) {
+        this->detach_.ZwClose(Event);
+        return Status;
+    }
+
+    this->detach_.ZwClose(Thread);
+    return 0;
+}
+
+template<>
+__forceinline
+void dispatch_table_impl<0, kernel_mode>::enter_detached() {
+    this->detach_.ZwWaitForSingleObject(this->detach_release_.handle, FALSE, NULL);
+    this->detach_.ZwClose(this->detach_release_.handle);
+}
+#endif
 
 #ifdef SCFW_ENABLE_LOAD_MODULE
 static_assert(false, "Dynamic module loading is not supported in kernel mode");
@@ -0,0 +1,126 @@
+#pragma once
+
+//
+// Run a function on every processor at once.
+//
+// `sc::kernel::for_each_cpu(fn)` broadcasts `fn` to all active processors
+// with `KeGenericCallDpc`. Every processor waits at a
+// `KeSignalCallDpcSynchronize` barrier first, so all of them call `fn` at
+// the same time, at DISPATCH_LEVEL, pinned to their own CPU - the right
+// context for reading MSRs, the IDT/GDT or the KPRCB.
+//
+// Requires `SCFW_ENABLE_FOR_EACH_CPU`.
+//
+//   uint64_t LStar[64];
+//   ULONG Count = ARRAYSIZE(LStar);
+//
+//   NTSTATUS Status = sc::kernel::for_each_cpu(LStar, Count, [](ULONG Cpu) {
+//       return __readmsr(0xC0000082);
+//   });
+//
+//   // LStar[0 .. Count) now holds one value per processor, indexed by
+//   // the system-wide processor number.
+//
+// Must be called at PASSIVE_LEVEL. Returns only after every processor has
+// not only signalled completion but also left the DPC routine
+// (`KeFlushQueuedDpcs`), so nothing runs in the shellcode afterwards and it
+// is safe to free it with `SCFW_ENABLE_CLEANUP`.
+//
+
+#include <type_traits>
+
+#include "../kernelmode.h"
+
+#ifndef SCFW_ENABLE_FOR_EACH_CPU
+#   error "for_each_cpu.h requires SCFW_ENABLE_FOR_EACH_CPU"
+#endif
+
+namespace sc {
+namespace detail {
+
+template <typename F>
+VOID NTAPI for_each_cpu_routine(struct _KDPC* Dpc, PVOID DeferredContext, PVOID SystemArgument1, PVOID SystemArgument2) {
+    (void)Dpc;
+
+    auto& api = base_table<SCFW_MODE>()->fields().for_each_cpu_;
+
+    //
+    // Line everybody up before calling `fn`, so the processors observe
+    // the system at (roughly) the same moment.
+    //
+
+    api.KeSignalCallDpcSynchronize(SystemArgument2);
+
+    ULONG Cpu = api.KeGetCurrentProcessorNumberEx(NULL);
+    (*static_cast<F*>(DeferredContext))(Cpu);
+
+    api.KeSignalCallDpcDone(SystemArgument1);
+}
+
+} // namespace detail
+
+namespace kernel {
+
+//
+// Number of active processors across all groups. Processor numbers passed
+// to `fn` are in `[0, processor_count())`.
+//
+
+__forceinline
+ULONG processor_count() {
+    auto& api = detail::base_table<detail::SCFW_MODE>()->fields().for_each_cpu_;
+    return api.KeQueryActiveProcessorCountEx(ALL_PROCESSOR_GROUPS);
+}
+
+//
+// Calls `fn(ULONG Cpu)` on every active processor in parallel.
+//
+
+template <typename F>
+void for_each_cpu(F&& fn) {
+    using function_type = std::remove_reference_t<F>;
+
+    auto& api = detail::base_table<detail::SCFW_MODE>()->fields().for_each_cpu_;
+
+    api.KeGenericCallDpc(_(&detail::for_each_cpu_routine<function_type>),
+                         const_cast<void*>(static_cast<const void*>(&fn)));
+
+    //
+    // `KeGenericCallDpc` returns once every processor has called
+    // `KeSignalCallDpcDone`, which is still a few instructions before the
+    // DPC routine returns. Wait for those as well.
+    //
+
+    api.KeFlushQueuedDpcs();
+}
+
+//
+// Calls `results[Cpu] = fn(Cpu)` on every active processor in parallel.
+//
+// On input, `count` is the number of elements in `results`; on output it
+// is the number of processors. Returns `STATUS_BUFFER_TOO_SMALL` without
+// running anything if `results` cannot hold one entry per processor.
+//
+
+template <typename T, typename F>
+NTSTATUS for_each_cpu(T* results, ULONG& count, F&& fn) {
+    ULONG Processors = processor_count();
+
+    if (count < Processors) {
+        count = Processors;
+        return STATUS_BUFFER_TOO_SMALL;
+    }
+
+    count = Processors;
+
+    for_each_cpu([results, Processors, &fn](ULONG Cpu) {
+        if (Cpu < Processors) {
+            results[Cpu] = fn(Cpu);
+        }
+    });
+
+    return STATUS_SUCCESS;
+}
+
+} // namespace kernel
+} // namespace sc
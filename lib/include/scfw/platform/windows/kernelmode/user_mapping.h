@@ -0,0 +1,193 @@
+#pragma once
+
+//
+// Zero-copy access to user-mode memory from a kernel payload.
+//
+// `sc::kernel::user_mapping` locks a range of a process's address space
+// with an MDL (`IoAllocateMdl` + `MmProbeAndLockPages`) and maps the locked
+// pages into system space (`MmMapLockedPagesSpecifyCache`). The payload then
+// reads or writes the user buffer through a `std::span`, from any process
+// context and at up to DISPATCH_LEVEL, with no intermediate pool copy.
+//
+// Requires `SCFW_ENABLE_USER_MAPPING`.
+//
+//   sc::kernel::user_mapping Mapping;
+//   NTSTATUS Status = Mapping.open(Process, UserBuffer, Length,
+//                                  sc::kernel::user_mapping::read_write);
+//   if (NT_SUCCESS(Status)) {
+//       memcpy(Mapping.view().data(), Result, Length);
+//   }                                        // unmapped and unlocked here
+//
+// `open()` must be called at PASSIVE_LEVEL or APC_LEVEL. Pass `nullptr` as
+// the process to lock the current process's memory; otherwise the thread
+// attaches to `process` (a referenced `PEPROCESS`) just long enough to lock
+// the pages.
+//
+// Shellcode has no SEH, so an exception from `MmProbeAndLockPages` would
+// bring the system down. The range is validated first with
+// `MmSecureVirtualMemory`, which fails gracefully on kernel addresses,
+// unmapped or inaccessible ranges - and also prevents the range from being
+// freed or reprotected while the pages are probed.
+//
+// That only rules out access violations. The probe still raises when the
+// pages cannot be locked: the process's working set quota or the system's
+// resources are exhausted (`STATUS_WORKING_SET_QUOTA`,
+// `STATUS_INSUFFICIENT_RESOURCES`), or a page cannot be read back in (an
+// in-page error, e.g. a file-backed view on failing or removed storage).
+// Each of those is a bugcheck here. Keep ranges small, and prefer private
+// committed memory to mapped files.
+//
+
+#include <span>
+
+#include "../kernelmode.h"
+
+#ifndef SCFW_ENABLE_USER_MAPPING
+#   error "user_mapping.h requires SCFW_ENABLE_USER_MAPPING"
+#endif
+
+namespace sc {
+namespace kernel {
+
+class user_mapping {
+public:
+    enum access_type {
+        read,
+        read_write,
+    };
+
+    user_mapping() = default;
+    user_mapping(const user_mapping&) = delete;
+    user_mapping& operator=(const user_mapping&) = delete;
+
+    __forceinline
+    ~user_mapping() {
+        destroy();
+    }
+
+    //
+    // Locks `[address, address + size)` in `process` (or the current
+    // process when `nullptr`) and maps it into system space. Any range held
+    // by this object is released first.
+    //
+
+    NTSTATUS open(void* process, void* address, size_t size, access_type access = read) {
+        auto& api = detail::base_table<detail::SCFW_MODE>()->fields().user_mapping_;
+
+        destroy();
+
+        if (size == 0 || size > MAXULONG ||
+            reinterpret_cast<uintptr_t>(address) + size < reinterpret_cast<uintptr_t>(address)) {
+            return STATUS_INVALID_PARAMETER;
+        }
+
+        auto Mdl = api.IoAllocateMdl(address, static_cast<ULONG>(size), FALSE, FALSE, NULL);
+        if (!Mdl) {
+            return STATUS_INSUFFICIENT_RESOURCES;
+        }
+
+        detail::windows::kernelmode::KAPC_STATE ApcState;
+        if (process) {
+            api.KeStackAttachProcess(process, &ApcState);
+        }
+
+        NTSTATUS Status = STATUS_ACCESS_VIOLATION;
+        HANDLE Secure = api.MmSecureVirtualMemory(address,
+                                                  size,
+                                                  access == read ? PAGE_READONLY : PAGE_READWRITE);
+
+        if (Secure) {
+            api.MmProbeAndLockPages(Mdl,
+                                    user_mode,
+                                    access == read ? detail::windows::kernelmode::IoReadAccess
+                                                   : detail::windows::kernelmode::IoWriteAccess);
+
+            //
+            // The locked pages stay resident and keep their physical
+            // backing; securing the range is only needed during the probe.
+            //
+
+            api.MmUnsecureVirtualMemory(Secure);
+            Status = STATUS_SUCCESS;
+        }
+
+        if (process) {
+            api.KeUnstackDetachProcess(&ApcState);
+        }
+
+        if (!NT_SUCCESS(Status)) {
+            api.IoFreeMdl(Mdl);
+            return Status;
+        }
+
+        auto Base = api.MmMapLockedPagesSpecifyCache(Mdl,
+                                                     kernel_mode,
+                                                     mm_cached,
+                                                     NULL,
+                                                     FALSE,
+                                                     normal_page_priority | mdl_mapping_no_execute);
+
+        if (!Base) {
+            api.MmUnlockPages(Mdl);
+            api.IoFreeMdl(Mdl);
+            return STATUS_INSUFFICIENT_RESOURCES;
+        }
+
+        mdl_ = Mdl;
+        base_ = static_cast<uint8_t*>(Base);
+        size_ = size;
+        return STATUS_SUCCESS;
+    }
+
+    //
+    // Unmaps and unlocks the range, if any. Callable at up to
+    // DISPATCH_LEVEL. Safe to call more than once.
+    //
+
+    void destroy() {
+        if (mdl_) {
+            auto& api = detail::base_table<detail::SCFW_MODE>()->fields().user_mapping_;
+            api.MmUnmapLockedPages(base_, mdl_);
+            api.MmUnlockPages(mdl_);
+            api.IoFreeMdl(mdl_);
+
+            mdl_ = nullptr;
+            base_ = nullptr;
+            size_ = 0;
+        }
+    }
+
+    //
+    // The user buffer, seen through its system-space mapping. Writable
+    // only if opened with `read_write`.
+    //
+
+    __forceinline
+    std::span<uint8_t> view() const {
+        return { base_, size_ };
+    }
+
+    __forceinline
+    explicit operator bool() const {
+        return mdl_ != nullptr;
+    }
+
+private:
+    //
+    // `KPROCESSOR_MODE`, `MEMORY_CACHING_TYPE` and `MM_PAGE_PRIORITY`
+    // values. `MdlMappingNoExecute` is honored since Windows 8.
+    //
+
+    static constexpr CCHAR kernel_mode = 0;
+    static constexpr CCHAR user_mode = 1;
+    static constexpr ULONG mm_cached = 1;
+    static constexpr ULONG normal_page_priority = 16;
+    static constexpr ULONG mdl_mapping_no_execute = 0x40000000;
+
+    detail::windows::kernelmode::PMDL mdl_{};
+    uint8_t* base_{};
+    size_t size_{};
+};
+
+} // namespace kernel
+} // namespace sc
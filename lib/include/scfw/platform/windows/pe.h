@@ -0,0 +1,595 @@
+#pragma once
+
+//
+// Zero-copy view of a PE image mapped in memory.
+//
+// Wraps the header walking the resolver does (DOS header -> NT headers ->
+// data directories) so payloads can reach sections, exports, imports and
+// relocations without re-implementing it:
+//
+//   sc::pe::image_view Image{ Module };
+//   if (!Image) { ... }                       // bad signatures / truncated
+//
+//   for (auto& Section : Image.sections()) { ... Image.section_data(Section) ... }
+//
+//   for (auto Export : Image.exports()) {
+//       // Export.name, Export.ordinal, Export.rva, Export.forwarded
+//   }
+//
+//   for (auto Import : Image.imports()) {
+//       // Import.name; Import.names() / Import.addresses() walk the
+//       // lookup table and the IAT in parallel
+//   }
+//
+//   for (auto Block : Image.relocations()) {
+//       // Block.page_rva, Block.entries (std::span<const uint16_t>)
+//   }
+//
+// Nothing is copied: every accessor returns pointers into the image. The
+// header pointers are computed once, when the view is built. Ranges refer
+// back to the view, so it has to outlive them.
+//
+// `image_view` is bounds-checked. Construction validates the DOS and NT
+// signatures and the optional header magic (the image must match the
+// shellcode's bitness). Every later RVA is checked against the image size,
+// i.e. `SizeOfImage`, or a smaller size given to the constructor. Accessors
+// return `nullptr` or an empty range for anything outside of it, so
+// malformed or truncated images can be inspected safely.
+//
+// `unchecked_image_view` trusts the image (e.g. a module the loader
+// mapped) and compiles down to the bare pointer arithmetic - the resolver
+// (`lookup_symbol` in `common.h`) uses it. The two views have the same
+// interface.
+//
+// Offsets and range checks are `constexpr`; anything that turns an RVA
+// into a pointer is not, as it needs `reinterpret_cast`.
+//
+
+#include <cstdint>
+#include <cstddef>
+#include <span>
+
+#include <phnt_windows.h>
+#include <phnt.h>
+
+namespace sc {
+namespace pe {
+
+template <bool Checked>
+class basic_image_view {
+public:
+    //
+    // One named export. `ordinal` is unbiased, i.e. an index into
+    // `AddressOfFunctions`. In a checked view, `name` is `nullptr` and
+    // `rva` 0 when they point outside of the image.
+    //
+
+    struct export_entry {
+        const char* name;
+        uint32_t rva;
+        uint16_t ordinal;
+        bool forwarded;
+    };
+
+    class export_table {
+    public:
+        class iterator {
+        public:
+            __forceinline
+            iterator(const export_table* table, uint32_t index)
+                : table_(table)
+                , index_(index)
+            {}
+
+            __forceinline export_entry operator*() const { return (*table_)[index_]; }
+            __forceinline iterator& operator++() { index_++; return *this; }
+            __forceinline bool operator==(const iterator& other) const { return index_ == other.index_; }
+
+        private:
+            const export_table* table_;
+            uint32_t index_;
+        };
+
+        export_table() = default;
+
+        __forceinline
+        explicit export_table(const basic_image_view& image)
+            : image_(&image)
+        {
+            auto Directory = image.directory(IMAGE_DIRECTORY_ENTRY_EXPORT);
+            if (Directory.empty()) {
+                return;
+            }
+
+            auto Exports = image.template at<IMAGE_EXPORT_DIRECTORY>(image.rva_of(Directory.data()));
+            if (!Exports) {
+                return;
+            }
+
+            directory_rva_ = image.rva_of(Directory.data());
+            directory_size_ = static_cast<uint32_t>(Directory.size());
+
+            names_ = image.template at<ULONG>(Exports->AddressOfNames, Exports->NumberOfNames);
+            ordinals_ = image.template at<USHORT>(Exports->AddressOfNameOrdinals, Exports->NumberOfNames);
+            functions_ = image.template at<ULONG>(Exports->AddressOfFunctions, Exports->NumberOfFunctions);
+
+            if (!Checked || (names_ && ordinals_ && functions_)) {
+                name_count_ = Exports->NumberOfNames;
+                function_count_ = Exports->NumberOfFunctions;
+            }
+        }
+
+        //
+        // Number of named exports.
+        //
+
+        __forceinline
+        uint32_t size() const {
+            return name_count_;
+        }
+
+        __forceinline
+        const char* name(uint32_t index) const {
+            return image_->string_at(names_[index]);
+        }
+
+        __forceinline
+        uint16_t ordinal(uint32_t index) const {
+            return ordinals_[index];
+        }
+
+        //
+        // RVA of the function at (unbiased) `ordinal`, or 0.
+        //
+
+        __forceinline
+        uint32_t function(uint32_t ordinal) const {
+            if constexpr (Checked) {
+                if (ordinal >= function_count_) {
+                    return 0;
+                }
+            }
+            return functions_[ordinal];
+        }
+
+        //
+        // Forwarded exports point back into the export directory, at a
+        // "MODULE.Function" string.
+        //
+
+        __forceinline
+        constexpr bool forwarded(uint32_t rva) const {
+            return rva - directory_rva_ < directory_size_;
+        }
+
+        __forceinline
+        const char* forwarder(uint32_t rva) const {
+            return forwarded(rva) ? image_->string_at(rva) : nullptr;
+        }
+
+        __forceinline
+        export_entry operator[](uint32_t index) const {
+            uint16_t Ordinal = ordinal(index);
+            uint32_t Rva = function(Ordinal);
+            return { name(index), Rva, Ordinal, forwarded(Rva) };
+        }
+
+        __forceinline iterator begin() const { return { this, 0 }; }
+        __forceinline iterator end() const { return { this, name_count_ }; }
+
+    private:
+        const basic_image_view* image_{};
+        const ULONG* names_{};
+        const USHORT* ordinals_{};
+        const ULONG* functions_{};
+        uint32_t name_count_{};
+        uint32_t function_count_{};
+        uint32_t directory_rva_{};
+        uint32_t directory_size_{};
+    };
+
+    //
+    // Zero-terminated thunk array: the import lookup table or the IAT.
+    //
+
+    class thunk_range {
+    public:
+        class iterator {
+        public:
+            __forceinline
+            iterator(const basic_image_view* image, const IMAGE_THUNK_DATA* thunk)
+                : image_(image)
+                , thunk_(thunk)
+            {}
+
+            __forceinline const IMAGE_THUNK_DATA& operator*() const { return *thunk_; }
+            __forceinline const IMAGE_THUNK_DATA* operator->() const { return thunk_; }
+
+            __forceinline
+            iterator& operator++() {
+                thunk_++;
+                return *this;
+            }
+
+            //
+            // Ends at the zero thunk, or (checked) at the end of the image.
+            //
+
+            __forceinline
+            bool operator==(const iterator&) const {
+                if constexpr (Checked) {
+                    if (!thunk_ || !image_->template at<IMAGE_THUNK_DATA>(image_->rva_of(thunk_))) {
+                        return true;
+                    }
+                }
+                return thunk_->u1.AddressOfData == 0;
+            }
+
+        private:
+            const basic_image_view* image_;
+            const IMAGE_THUNK_DATA* thunk_;
+        };
+
+        __forceinline iterator begin() const { return { image_, first_ }; }
+        __forceinline iterator end() const { return { image_, nullptr }; }
+
+        const basic_image_view* image_;
+        const IMAGE_THUNK_DATA* first_;
+    };
+
+    struct import_module {
+        //
+        // Hint/name entry of a lookup thunk, or `nullptr` for imports by
+        // ordinal (and, checked, for names not terminated in the image).
+        //
+
+        __forceinline
+        const IMAGE_IMPORT_BY_NAME* by_name(const IMAGE_THUNK_DATA& thunk) const {
+            if (IMAGE_SNAP_BY_ORDINAL(thunk.u1.Ordinal)) {
+                return nullptr;
+            }
+
+            uint32_t Rva = static_cast<uint32_t>(thunk.u1.AddressOfData);
+            if constexpr (Checked) {
+                if (!image->string_at(Rva + FIELD_OFFSET(IMAGE_IMPORT_BY_NAME, Name))) {
+                    return nullptr;
+                }
+            }
+            return image->template at<IMAGE_IMPORT_BY_NAME>(Rva);
+        }
+
+        //
+        // Import lookup table (falls back to the IAT for images without
+        // one) and the IAT, entry for entry.
+        //
+
+        __forceinline
+        thunk_range names() const {
+            uint32_t Rva = descriptor->OriginalFirstThunk ? descriptor->OriginalFirstThunk : descriptor->FirstThunk;
+            return { image, image->template at<IMAGE_THUNK_DATA>(Rva) };
+        }
+
+        __forceinline
+        thunk_range addresses() const {
+            return { image, image->template at<IMAGE_THUNK_DATA>(descriptor->FirstThunk) };
+        }
+
+        const basic_image_view* image;
+        const IMAGE_IMPORT_DESCRIPTOR* descriptor;
+        const char* name;
+    };
+
+    class import_range {
+    public:
+        class iterator {
+        public:
+            __forceinline
+            iterator(const basic_image_view* image, const IMAGE_IMPORT_DESCRIPTOR* descriptor, const IMAGE_IMPORT_DESCRIPTOR* last)
+                : image_(image)
+                , descriptor_(descriptor)
+                , last_(last)
+            {}
+
+            __forceinline
+            import_module operator*() const {
+                return { image_, descriptor_, image_->string_at(descriptor_->Name) };
+            }
+
+            __forceinline
+            iterator& operator++() {
+                descriptor_++;
+                return *this;
+            }
+
+            //
+            // Ends at the zero descriptor or the end of the directory.
+            //
+
+            __forceinline
+            bool operator==(const iterator&) const {
+                return descriptor_ == last_ || descriptor_->Name == 0;
+            }
+
+        private:
+            const basic_image_view* image_;
+            const IMAGE_IMPORT_DESCRIPTOR* descriptor_;
+            const IMAGE_IMPORT_DESCRIPTOR* last_;
+        };
+
+        __forceinline iterator begin() const { return { image_, first_, last_ }; }
+        __forceinline iterator end() const { return { image_, last_, last_ }; }
+
+        const basic_image_view* image_;
+        const IMAGE_IMPORT_DESCRIPTOR* first_;
+        const IMAGE_IMPORT_DESCRIPTOR* last_;
+    };
+
+    struct relocation_block {
+        uint32_t page_rva;
+        std::span<const uint16_t> entries;   // type << 12 | page offset
+    };
+
+    class relocation_range {
+    public:
+        class iterator {
+        public:
+            __forceinline
+            iterator(const uint8_t* block, const uint8_t* last)
+                : block_(block)
+                , last_(last)
+            {}
+
+            __forceinline
+            relocation_block operator*() const {
+                auto Block = reinterpret_cast<const IMAGE_BASE_RELOCATION*>(block_);
+                return {
+                    Block->VirtualAddress,
+                    { reinterpret_cast<const uint16_t*>(Block + 1),
+                      (Block->SizeOfBlock - sizeof(IMAGE_BASE_RELOCATION)) / sizeof(uint16_t) }
+                };
+            }
+
+            __forceinline
+            iterator& operator++() {
+                block_ += reinterpret_cast<const IMAGE_BASE_RELOCATION*>(block_)->SizeOfBlock;
+                return *this;
+            }
+
+            //
+            // Ends at the end of the directory, or at a block whose size is
+            // too small to advance or runs past the directory.
+            //
+
+            __forceinline
+            bool operator==(const iterator&) const {
+                if (static_cast<size_t>(last_ - block_) < sizeof(IMAGE_BASE_RELOCATION)) {
+                    return true;
+                }
+
+                ULONG Size = reinterpret_cast<const IMAGE_BASE_RELOCATION*>(block_)->SizeOfBlock;
+                return Size < sizeof(IMAGE_BASE_RELOCATION) || Size > static_cast<size_t>(last_ - block_);
+            }
+
+        private:
+            const uint8_t* block_;
+            const uint8_t* last_;
+        };
+
+        __forceinline iterator begin() const { return { directory_.data(), directory_.data() + directory_.size() }; }
+        __forceinline iterator end() const { return begin(); }
+
+        std::span<const uint8_t> directory_;
+    };
+
+    basic_image_view() = default;
+
+    //
+    // View of the image mapped at `base`, `SizeOfImage` bytes long.
+    //
+
+    __forceinline
+    explicit basic_image_view(const void* base)
+        : basic_image_view(base, SIZE_MAX)
+    {}
+
+    //
+    // View of at most `size` bytes at `base` (checked view only - the
+    // unchecked one ignores `size`).
+    //
+
+    __forceinline
+    basic_image_view(const void* base, size_t size)
+        : base_(static_cast<const uint8_t*>(base))
+    {
+        if constexpr (Checked) {
+            if (!base_ || size < sizeof(IMAGE_DOS_HEADER)) {
+                return;
+            }
+
+            //
+            // The whole of IMAGE_NT_HEADERS (Signature, FileHeader and
+            // OptionalHeader) must fit before any of it is read. Written
+            // as `size - e_lfanew` so that it can't wrap.
+            //
+
+            auto DosHeader = reinterpret_cast<const IMAGE_DOS_HEADER*>(base_);
+            if (DosHeader->e_magic != IMAGE_DOS_SIGNATURE ||
+                DosHeader->e_lfanew < 0 ||
+                static_cast<size_t>(DosHeader->e_lfanew) > size ||
+                size - static_cast<size_t>(DosHeader->e_lfanew) < sizeof(IMAGE_NT_HEADERS)) {
+                return;
+            }
+
+            auto NtHeaders = reinterpret_cast<const IMAGE_NT_HEADERS*>(base_ + DosHeader->e_lfanew);
+            if (NtHeaders->Signature != IMAGE_NT_SIGNATURE ||
+                NtHeaders->OptionalHeader.Magic != IMAGE_NT_OPTIONAL_HDR_MAGIC) {
+                return;
+            }
+
+            size_ = NtHeaders->OptionalHeader.SizeOfImage < size ? NtHeaders->OptionalHeader.SizeOfImage : size;
+            nt_headers_ = NtHeaders;
+
+            //
+            // Section headers must be inside the image too.
+            //
+
+            if (!at<IMAGE_SECTION_HEADER>(rva_of(IMAGE_FIRST_SECTION(NtHeaders)),
+                                          NtHeaders->FileHeader.NumberOfSections)) {
+                nt_headers_ = nullptr;
+                size_ = 0;
+            }
+        } else {
+            (void)size;
+            auto DosHeader = reinterpret_cast<const IMAGE_DOS_HEADER*>(base_);
+            nt_headers_ = reinterpret_cast<const IMAGE_NT_HEADERS*>(base_ + DosHeader->e_lfanew);
+            size_ = nt_headers_->OptionalHeader.SizeOfImage;
+        }
+    }
+
+    //
+    // Whether the headers are valid. Always `true` for an unchecked view
+    // built from an image.
+    //
+
+    __forceinline
+    explicit operator bool() const {
+        return nt_headers_ != nullptr;
+    }
+
+    __forceinline const uint8_t* base() const { return base_; }
+    __forceinline size_t size() const { return size_; }
+    __forceinline const IMAGE_NT_HEADERS* nt_headers() const { return nt_headers_; }
+
+    __forceinline
+    constexpr bool contains(uint32_t rva, size_t size) const {
+        return rva <= size_ && size <= size_ - rva;
+    }
+
+    __forceinline
+    uint32_t rva_of(const void* pointer) const {
+        return static_cast<uint32_t>(static_cast<const uint8_t*>(pointer) - base_);
+    }
+
+    //
+    // `count` objects of type `T` at `rva`, or `nullptr` if they are not
+    // inside the image.
+    //
+
+    template <typename T>
+    __forceinline
+    const T* at(uint32_t rva, size_t count = 1) const {
+        if constexpr (Checked) {
+            if (!nt_headers_ || count > size_ / sizeof(T) || !contains(rva, count * sizeof(T))) {
+                return nullptr;
+            }
+        }
+        return reinterpret_cast<const T*>(base_ + rva);
+    }
+
+    //
+    // NUL-terminated string at `rva`, or `nullptr` if it is not terminated
+    // inside the image.
+    //
+
+    __forceinline
+    const char* string_at(uint32_t rva) const {
+        if constexpr (Checked) {
+            if (!nt_headers_ || rva >= size_ || !memchr(base_ + rva, 0, size_ - rva)) {
+                return nullptr;
+            }
+        }
+        return reinterpret_cast<const char*>(base_ + rva);
+    }
+
+    //
+    // Contents of data directory `index` (`IMAGE_DIRECTORY_ENTRY_*`); empty
+    // if absent or out of bounds.
+    //
+
+    __forceinline
+    std::span<const uint8_t> directory(uint32_t index) const {
+        if constexpr (Checked) {
+            if (!nt_headers_ || index >= nt_headers_->OptionalHeader.NumberOfRvaAndSizes) {
+                return {};
+            }
+        }
+
+        auto& Entry = nt_headers_->OptionalHeader.DataDirectory[index];
+        if constexpr (Checked) {
+            if (!Entry.VirtualAddress || !contains(Entry.VirtualAddress, Entry.Size)) {
+                return {};
+            }
+        }
+
+        return { base_ + Entry.VirtualAddress, Entry.Size };
+    }
+
+    __forceinline
+    std::span<const IMAGE_SECTION_HEADER> sections() const {
+        if constexpr (Checked) {
+            if (!nt_headers_) {
+                return {};
+            }
+        }
+        return { IMAGE_FIRST_SECTION(nt_headers_), nt_headers_->FileHeader.NumberOfSections };
+    }
+
+    //
+    // Mapped contents of `section` (`VirtualSize`, or `SizeOfRawData` when
+    // the linker left it zero); empty if out of bounds.
+    //
+
+    __forceinline
+    std::span<const uint8_t> section_data(const IMAGE_SECTION_HEADER& section) const {
+        DWORD Size = section.Misc.VirtualSize ? section.Misc.VirtualSize : section.SizeOfRawData;
+        auto Data = at<uint8_t>(section.VirtualAddress, Size);
+        if constexpr (Checked) {
+            if (!Data) {
+                return {};
+            }
+        }
+        return { Data, Size };
+    }
+
+    //
+    // Section containing `rva`, or `nullptr`.
+    //
+
+    const IMAGE_SECTION_HEADER* section_of(uint32_t rva) const {
+        for (auto& Section : sections()) {
+            DWORD Size = Section.Misc.VirtualSize ? Section.Misc.VirtualSize : Section.SizeOfRawData;
+            if (rva - Section.VirtualAddress < Size) {
+                return &Section;
+            }
+        }
+        return nullptr;
+    }
+
+    __forceinline
+    export_table exports() const {
+        return export_table{ *this };
+    }
+
+    __forceinline
+    import_range imports() const {
+        auto Directory = directory(IMAGE_DIRECTORY_ENTRY_IMPORT);
+        auto First = reinterpret_cast<const IMAGE_IMPORT_DESCRIPTOR*>(Directory.data());
+        return { this, First, First + Directory.size() / sizeof(IMAGE_IMPORT_DESCRIPTOR) };
+    }
+
+    __forceinline
+    relocation_range relocations() const {
+        return { directory(IMAGE_DIRECTORY_ENTRY_BASERELOC) };
+    }
+
+private:
+    const uint8_t* base_{};
+    const IMAGE_NT_HEADERS* nt_headers_{};
+    size_t size_{};
+};
+
+using image_view = basic_image_view<true>;
+using unchecked_image_view = basic_image_view<false>;
+
+} // namespace pe
+} // namespace sc
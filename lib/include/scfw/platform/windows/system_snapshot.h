@@ -0,0 +1,220 @@
+#pragma once
+
+//
+// Reusable snapshot of the running processes and their threads.
+//
+// `sc::system_snapshot` queries `SystemProcessInformation` into a buffer
+// taken from an `sc::arena` and keeps it across refreshes. Polling the
+// process list therefore costs one query per `refresh()` in the steady
+// state: the buffer only grows (geometrically) when the list outgrew it,
+// instead of allocating, failing with `STATUS_INFO_LENGTH_MISMATCH` and
+// retrying on every call. Entries are read in place, nothing is copied.
+//
+// Requires `SCFW_ENABLE_SYSTEM_SNAPSHOT`. Works in user mode
+// (`NtQuerySystemInformation`) and kernel mode (`ZwQuerySystemInformation`,
+// PASSIVE_LEVEL); include `usermode.h` or `kernelmode.h` first.
+//
+//   uint8_t Storage[256 * 1024];
+//   sc::arena Arena{ Storage, sizeof(Storage) };
+//   sc::system_snapshot Snapshot{ Arena };
+//
+//   while (NT_SUCCESS(Snapshot.refresh())) {
+//       for (auto& Process : Snapshot.processes()) {
+//           for (auto& Thread : sc::system_snapshot::threads(Process)) { ... }
+//       }
+//   }
+//
+// The buffer grows in place as long as it is the arena's most recent
+// allocation. Otherwise a new one is allocated and the old one stays in
+// the arena until the caller rewinds past it.
+//
+
+#include <cstdint>
+#include <cstddef>
+#include <span>
+
+#include "../../runtime/arena.h"
+#include "common.h"
+
+#ifndef SCFW_MODE
+#   error "system_snapshot.h requires usermode.h or kernelmode.h to be included first"
+#endif
+
+#ifndef SCFW_ENABLE_SYSTEM_SNAPSHOT
+#   error "system_snapshot.h requires SCFW_ENABLE_SYSTEM_SNAPSHOT"
+#endif
+
+namespace sc {
+
+class system_snapshot {
+public:
+    //
+    // Forward iterator over the `SYSTEM_PROCESS_INFORMATION` chain.
+    //
+
+    class process_iterator {
+    public:
+        using value_type = SYSTEM_PROCESS_INFORMATION;
+        using difference_type = ptrdiff_t;
+        using pointer = const SYSTEM_PROCESS_INFORMATION*;
+        using reference = const SYSTEM_PROCESS_INFORMATION&;
+
+        process_iterator() = default;
+
+        __forceinline
+        explicit process_iterator(pointer entry)
+            : entry_(entry)
+        {}
+
+        __forceinline
+        reference operator*() const {
+            return *entry_;
+        }
+
+        __forceinline
+        pointer operator->() const {
+            return entry_;
+        }
+
+        __forceinline
+        process_iterator& operator++() {
+            entry_ = entry_->NextEntryOffset
+                ? reinterpret_cast<pointer>(reinterpret_cast<const uint8_t*>(entry_) + entry_->NextEntryOffset)
+                : nullptr;
+            return *this;
+        }
+
+        __forceinline
+        process_iterator operator++(int) {
+            process_iterator Previous = *this;
+            ++*this;
+            return Previous;
+        }
+
+        __forceinline
+        bool operator==(const process_iterator& other) const {
+            return entry_ == other.entry_;
+        }
+
+    private:
+        pointer entry_{};
+    };
+
+    struct process_range {
+        __forceinline
+        process_iterator begin() const {
+            return process_iterator{ first };
+        }
+
+        __forceinline
+        process_iterator end() const {
+            return process_iterator{};
+        }
+
+        const SYSTEM_PROCESS_INFORMATION* first;
+    };
+
+    __forceinline
+    explicit system_snapshot(arena& arena)
+        : arena_(&arena)
+    {}
+
+    system_snapshot(const system_snapshot&) = delete;
+    system_snapshot& operator=(const system_snapshot&) = delete;
+
+    //
+    // Re-queries the process list into the buffer, growing it if needed.
+    // On failure the snapshot is empty. Entries obtained before the call
+    // are invalidated either way.
+    //
+
+    NTSTATUS refresh() {
+        auto& api = detail::base_table<detail::SCFW_MODE>()->fields().system_snapshot_;
+
+        valid_ = false;
+
+        for (;;) {
+            ULONG RequiredLength = 0;
+            NTSTATUS Status = api.QuerySystemInformation(SystemProcessInformation,
+                                                         buffer_,
+                                                         capacity_,
+                                                         &RequiredLength);
+
+            if (Status != STATUS_INFO_LENGTH_MISMATCH) {
+                valid_ = NT_SUCCESS(Status);
+                return Status;
+            }
+
+            //
+            // The list can grow between the two queries: leave some slack,
+            // and at least double so that a steadily growing list does not
+            // reallocate on every refresh.
+            //
+
+            size_t Capacity = static_cast<size_t>(RequiredLength) + RequiredLength / 8;
+            if (Capacity < static_cast<size_t>(capacity_) * 2) {
+                Capacity = static_cast<size_t>(capacity_) * 2;
+            }
+            if (Capacity > MAXULONG) {
+                Capacity = MAXULONG;
+            }
+            if (Capacity <= capacity_) {
+                return STATUS_INFO_LENGTH_MISMATCH;
+            }
+
+            if (!buffer_ || !arena_->resize(buffer_, Capacity)) {
+                void* Buffer = arena_->allocate(Capacity);
+                if (!Buffer) {
+                    return STATUS_NO_MEMORY;
+                }
+                buffer_ = Buffer;
+            }
+
+            capacity_ = static_cast<ULONG>(Capacity);
+        }
+    }
+
+    //
+    // Processes of the last successful `refresh()`; empty otherwise.
+    //
+
+    __forceinline
+    process_range processes() const {
+        return { valid_ ? static_cast<const SYSTEM_PROCESS_INFORMATION*>(buffer_) : nullptr };
+    }
+
+    //
+    // Threads of `process`, in place.
+    //
+
+    __forceinline
+    static std::span<const SYSTEM_THREAD_INFORMATION> threads(const SYSTEM_PROCESS_INFORMATION& process) {
+        return { process.Threads, process.NumberOfThreads };
+    }
+
+    //
+    // Entry of the process with id `process_id`, or `nullptr`.
+    //
+
+    const SYSTEM_PROCESS_INFORMATION* find(HANDLE process_id) const {
+        for (auto& Process : processes()) {
+            if (Process.UniqueProcessId == process_id) {
+                return &Process;
+            }
+        }
+        return nullptr;
+    }
+
+    __forceinline
+    size_t capacity() const {
+        return capacity_;
+    }
+
+private:
+    arena* arena_;
+    void* buffer_{};
+    ULONG capacity_{};
+    bool valid_{};
+};
+
+} // namespace sc
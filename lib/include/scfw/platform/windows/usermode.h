@@ -12,16 +12,65 @@
 //=============================================================================
 //
 //   SCFW_ENABLE_FULL_MODULE_SEARCH
-//     Disables the ntdll/kernel32 fast-path optimization. By default,
-//     find_module("ntdll.dll") and find_module("kernel32.dll") use
-//     hardcoded PEB offsets (2nd and 3rd entries). Define this to always
-//     walk the full module list instead.
+//     Disables the positional fast paths. By default, find_module() first
+//     checks the entry at a module's expected position in the PEB load
+//     order list (ntdll.dll 2nd, kernel32.dll 3rd) and only walks the list
+//     if another module is there. Define this to always walk the full
+//     module list instead; saves a few bytes.
+//
+//   SCFW_MODULE_HINTS
+//     Additional positional hints for a known target environment, as a
+//     sequence of `SCFW_MODULE_HINT("name.dll", position)` (position 0 is
+//     the exe). Tried before the default ones; see "Positional hints" in
+//     `common.h`.
 //
 //   SCFW_ENABLE_FIND_MODULE_FORWARDER
 //     Enables support for forwarded PE exports. Some exports redirect
 //     to another DLL (e.g., kernel32!HeapAlloc -> ntdll!RtlAllocateHeap).
 //     When enabled, lookup_symbol detects these and recursively resolves
-//     the target. Adds code size; only enable if you need it.
+//     the target, found in the PEB by the hash of its name without
+//     extension. Adds code size; only enable if you need it. Also
+//     available in kernel mode (see `kernelmode.h`).
+//
+//   SCFW_ENABLE_MAPPED_FILE
+//     Resolves `NtCreateFile`, `NtQueryInformationFile`, `NtCreateSection`,
+//     `NtMapViewOfSection`, `NtUnmapViewOfSection` and `NtClose` from ntdll
+//     at init time. Required by `sc::mapped_file` (`usermode/mapped_file.h`).
+//
+//   SCFW_ENABLE_ASYNC_IO
+//     Resolves `NtCreateIoCompletion`, `NtSetInformationFile`, `NtReadFile`,
+//     `NtWriteFile`, `NtRemoveIoCompletionEx`, `NtCancelIoFileEx` and
+//     `NtClose` from ntdll at init time. Required by `sc::async_io`
+//     (`usermode/async_io.h`).
+//
+//   SCFW_ENABLE_PARALLEL_FOR
+//     Resolves `TpAllocWork`, `TpPostWork`, `TpWaitForWork` and
+//     `TpReleaseWork` from ntdll at init time. Required by
+//     `sc::parallel_for` (`usermode/parallel_for.h`).
+//
+//   SCFW_ENABLE_WAIT_ON_ADDRESS
+//     Resolves `RtlWaitOnAddress`, `RtlWakeAddressSingle` and
+//     `RtlWakeAddressAll` from ntdll at init time (Windows 8+; left null on
+//     older systems). Required by the `sc::wait_on_address` waiter policy
+//     (`usermode/wait_on_address.h`).
+//
+//   SCFW_ENABLE_SYSTEM_SNAPSHOT
+//     Resolves `NtQuerySystemInformation` from ntdll at init time.
+//     Required by `sc::system_snapshot` (`system_snapshot.h`).
+//
+//   SCFW_ENABLE_SCAVENGE_IAT
+//     Locates the image whose import table `SCFW_FLAG_SCAVENGE_IAT`
+//     entries are read from: the process image (`Peb->ImageBaseAddress`),
+//     or the loaded module named by `SCFW_SCAVENGE_IAT_MODULE` (e.g.
+//     "kernelbase.dll"), looked up like an `IMPORT_MODULE`. The process
+//     image is the natural choice when the host program is known to import
+//     the APIs in question; it costs no module list walk.
+//
+//   SCFW_ENABLE_DETACH
+//     Set via the CMake option `SCFW_OPT_DETACH`. Resolves
+//     `RtlCreateUserThread`, `NtResumeThread` and `NtClose` from ntdll;
+//     `_entry` uses them to run `entry()` on a new thread and returns to
+//     the caller immediately.
 //
 //=============================================================================
 // DISPATCH TABLE BASE LAYOUT
@@ -80,50 +129,130 @@ struct mode_traits<user_mode> {
 #ifdef SCFW_ENABLE_LOOKUP_SYMBOL
     using lookup_symbol_fn = decltype(&::GetProcAddress);
 #endif
+#ifdef SCFW_ENABLE_MAPPED_FILE
+    struct mapped_file_api {
+        decltype(&::NtCreateFile) NtCreateFile;
+        decltype(&::NtQueryInformationFile) NtQueryInformationFile;
+        decltype(&::NtCreateSection) NtCreateSection;
+        decltype(&::NtMapViewOfSection) NtMapViewOfSection;
+        decltype(&::NtUnmapViewOfSection) NtUnmapViewOfSection;
+        decltype(&::NtClose) NtClose;
+    };
+#endif
+#ifdef SCFW_ENABLE_ASYNC_IO
+    struct async_io_api {
+        decltype(&::NtCreateIoCompletion) NtCreateIoCompletion;
+        decltype(&::NtSetInformationFile) NtSetInformationFile;
+        decltype(&::NtReadFile) NtReadFile;
+        decltype(&::NtWriteFile) NtWriteFile;
+        decltype(&::NtRemoveIoCompletionEx) NtRemoveIoCompletionEx;
+        decltype(&::NtCancelIoFileEx) NtCancelIoFileEx;
+        decltype(&::NtClose) NtClose;
+    };
+#endif
+#ifdef SCFW_ENABLE_PARALLEL_FOR
+    struct parallel_for_api {
+        decltype(&::TpAllocWork) TpAllocWork;
+        decltype(&::TpPostWork) TpPostWork;
+        decltype(&::TpWaitForWork) TpWaitForWork;
+        decltype(&::TpReleaseWork) TpReleaseWork;
+    };
+#endif
+#ifdef SCFW_ENABLE_DETACH
+    struct detach_api {
+        decltype(&::RtlCreateUserThread) RtlCreateUserThread;
+        decltype(&::NtResumeThread) NtResumeThread;
+        decltype(&::NtClose) NtClose;
+    };
+#endif
+#ifdef SCFW_ENABLE_WAIT_ON_ADDRESS
+    struct wait_on_address_api {
+        decltype(&::RtlWaitOnAddress) RtlWaitOnAddress;
+        decltype(&::RtlWakeAddressSingle) RtlWakeAddressSingle;
+        decltype(&::RtlWakeAddressAll) RtlWakeAddressAll;
+    };
+#endif
+#ifdef SCFW_ENABLE_SYSTEM_SNAPSHOT
+    struct system_snapshot_api {
+        decltype(&::NtQuerySystemInformation) QuerySystemInformation;
+    };
+#endif
+#ifdef SCFW_ENABLE_FOR_EACH_CPU
+    static_assert(false, "for_each_cpu is not supported in user mode");
+    using for_each_cpu_api = void;
+#endif
+#ifdef SCFW_ENABLE_USER_MAPPING
+    static_assert(false, "user_mapping is not supported in user mode");
+    using user_mapping_api = void;
+#endif
+#ifdef SCFW_ENABLE_INIT_CONTEXT
+    struct init_state {};
+#endif
+
+    //
+    // With the positional hints (`common.h`), the compiler keeps only the
+    // checks for hints naming this module: the name or hash is a constant.
+    //
 
     static void* find_module(const char* name) {
 #ifndef SCFW_ENABLE_FULL_MODULE_SEARCH
-        // Constant string comparisons - the compiler optimizes these away at
-        // compile time, keeping only the matching branch.
-        if (_stricmp(name, "ntdll.dll") == 0) {
-            return windows::usermode::find_module_ntdll();
-        }
-
-        if (_stricmp(name, "kernel32.dll") == 0) {
-            return windows::usermode::find_module_kernel32();
-        }
-#endif
+        return windows::usermode::find_module_hinted(name);
+#else
         return windows::usermode::find_module(name);
+#endif
     }
 
     static void* find_module(uint32_t hash) {
 #ifndef SCFW_ENABLE_FULL_MODULE_SEARCH
-        // Constant string comparisons - the compiler optimizes these away at
-        // compile time, keeping only the matching branch.
-        if (hash == fnv1a_hash("ntdll.dll")) {
-            return windows::usermode::find_module_ntdll();
-        }
-        if (hash == fnv1a_hash("kernel32.dll")) {
-            return windows::usermode::find_module_kernel32();
-        }
-#endif
+        return windows::usermode::find_module_hinted(hash);
+#else
         return windows::usermode::find_module(hash);
+#endif
     }
 
     template <typename F>
     static F lookup_symbol(void* module, const char* name) {
+#ifdef SCFW_ENABLE_FIND_MODULE_FORWARDER
+        return windows::lookup_symbol<F>(module, name, [](uint32_t module_hash) {
+            return windows::usermode::find_module_stem(module_hash);
+        });
+#else
         return windows::lookup_symbol<F>(module, name);
+#endif
     }
 
     template <typename F>
     static F lookup_symbol(void* module, uint32_t hash) {
+#ifdef SCFW_ENABLE_FIND_MODULE_FORWARDER
+        return windows::lookup_symbol<F>(module, hash, [](uint32_t module_hash) {
+            return windows::usermode::find_module_stem(module_hash);
+        });
+#else
         return windows::lookup_symbol<F>(module, hash);
+#endif
+    }
+
+    static bool image_matches(void* module, uint32_t time_date_stamp, uint32_t size_of_image) {
+        return windows::image_matches(module, time_date_stamp, size_of_image);
+    }
+
+    template <typename F>
+    static F scavenge_symbol(void* source, uint32_t module_hash, const char* name) {
+        return windows::scavenge_symbol<F>(source, module_hash, name);
+    }
+
+    template <typename F>
+    static F scavenge_symbol(void* source, uint32_t module_hash, uint32_t hash) {
+        return windows::scavenge_symbol<F>(source, module_hash, hash);
     }
 };
 
 template<>
 __forceinline
-int dispatch_table_impl<0, user_mode>::init(void* argument1, void* argument2) {
+int dispatch_table_impl<0, user_mode>::init(init_context<user_mode>& context,
+                                            void* argument1,
+                                            void* argument2) {
+    (void)context;
     (void)argument1;
     (void)argument2;
 
@@ -183,6 +312,72 @@ int dispatch_table_impl<0, user_mode>::init(void* argument1, void* argument2) {
     this->unload_module_ = mode::lookup_symbol<typename mode::unload_module_fn>(kernel32, SCFW__SYMBOL("FreeLibrary"));
 #endif
 
+    //
+    // Native API used by the framework helpers. Always taken from `ntdll`,
+    // which is found through its positional hint (see `find_module()` above).
+    //
+
+#if defined(SCFW_ENABLE_MAPPED_FILE)                                          \
+    || defined(SCFW_ENABLE_ASYNC_IO)                                          \
+    || defined(SCFW_ENABLE_PARALLEL_FOR)                                      \
+    || defined(SCFW_ENABLE_WAIT_ON_ADDRESS)                                   \
+    || defined(SCFW_ENABLE_SYSTEM_SNAPSHOT)                                   \
+    || defined(SCFW_ENABLE_DETACH)
+    auto ntdll = mode::find_module(SCFW__MODULE("ntdll.dll"));
+
+#   define SCFW__RESOLVE(api, name)                                           \
+        api.name = mode::lookup_symbol<decltype(api.name)>(ntdll, SCFW__SYMBOL(#name))
+#endif
+
+#ifdef SCFW_ENABLE_DETACH
+    SCFW__RESOLVE(this->detach_, RtlCreateUserThread);
+    SCFW__RESOLVE(this->detach_, NtResumeThread);
+    SCFW__RESOLVE(this->detach_, NtClose);
+#endif
+#ifdef SCFW_ENABLE_MAPPED_FILE
+    SCFW__RESOLVE(this->mapped_file_, NtCreateFile);
+    SCFW__RESOLVE(this->mapped_file_, NtQueryInformationFile);
+    SCFW__RESOLVE(this->mapped_file_, NtCreateSection);
+    SCFW__RESOLVE(this->mapped_file_, NtMapViewOfSection);
+    SCFW__RESOLVE(this->mapped_file_, NtUnmapViewOfSection);
+    SCFW__RESOLVE(this->mapped_file_, NtClose);
+#endif
+#ifdef SCFW_ENABLE_ASYNC_IO
+    SCFW__RESOLVE(this->async_io_, NtCreateIoCompletion);
+    SCFW__RESOLVE(this->async_io_, NtSetInformationFile);
+    SCFW__RESOLVE(this->async_io_, NtReadFile);
+    SCFW__RESOLVE(this->async_io_, NtWriteFile);
+    SCFW__RESOLVE(this->async_io_, NtRemoveIoCompletionEx);
+    SCFW__RESOLVE(this->async_io_, NtCancelIoFileEx);
+    SCFW__RESOLVE(this->async_io_, NtClose);
+#endif
+#ifdef SCFW_ENABLE_PARALLEL_FOR
+    SCFW__RESOLVE(this->parallel_for_, TpAllocWork);
+    SCFW__RESOLVE(this->parallel_for_, TpPostWork);
+    SCFW__RESOLVE(this->parallel_for_, TpWaitForWork);
+    SCFW__RESOLVE(this->parallel_for_, TpReleaseWork);
+#endif
+#ifdef SCFW_ENABLE_WAIT_ON_ADDRESS
+    SCFW__RESOLVE(this->wait_on_address_, RtlWaitOnAddress);
+    SCFW__RESOLVE(this->wait_on_address_, RtlWakeAddressSingle);
+    SCFW__RESOLVE(this->wait_on_address_, RtlWakeAddressAll);
+#endif
+#ifdef SCFW_ENABLE_SYSTEM_SNAPSHOT
+    this->system_snapshot_.QuerySystemInformation =
+        mode::lookup_symbol<decltype(this->system_snapshot_.QuerySystemInformation)>(
+            ntdll, SCFW__SYMBOL("NtQuerySystemInformation"));
+#endif
+
+#ifdef SCFW_ENABLE_SCAVENGE_IAT
+#   ifdef SCFW_SCAVENGE_IAT_MODULE
+    this->set_iat_source(context,
+                         mode::find_module(SCFW__MODULE(SCFW_SCAVENGE_IAT_MODULE)));
+#   else
+    this->set_iat_source(context, NtCurrentPeb()->ImageBaseAddress);
+#   endif
+#endif
+
+#undef SCFW__RESOLVE
 #undef SCFW__SYMBOL
 #undef SCFW__MODULE
 
@@ -202,6 +397,51 @@ void dispatch_table_impl<0, user_mode>::destroy(void* argument1, void* argument2
     (void)argument2;
 }
 
+#ifdef SCFW_ENABLE_DETACH
+template<>
+__forceinline
+int dispatch_table_impl<0, user_mode>::detach(void* argument1, void* argument2) {
+    //
+    // The new thread starts at `_start_thread` and picks the arguments up
+    // from the dispatch table. It is created suspended: with cleanup
+    // enabled it frees the shellcode (`_start` -> `_cleanup_usermode`),
+    // so it must not run before the caller's thread is out of it.
+    // `_detach` resumes it with a tail-jump to `NtResumeThread`, and the
+    // thread closes its own handle in `enter_detached()`.
+    //
+
+    this->detach_argument1_ = argument1;
+    this->detach_argument2_ = argument2;
+
+    HANDLE Thread;
+    NTSTATUS Status = this->detach_.RtlCreateUserThread(
+        NtCurrentProcess(),
+        NULL,
+        TRUE,
+        0,
+        0,
+        0,
+        reinterpret_cast<PUSER_THREAD_START_ROUTINE>(_(&::_start_thread)),
+        NULL,
+        &Thread,
+        NULL);
+
+    if (!NT_SUCCESS(Status)) {
+        return Status;
+    }
+
+    this->detach_release_.routine = reinterpret_cast<void*>(this->detach_.NtResumeThread);
+    this->detach_release_.handle = Thread;
+    return 0;
+}
+
+template<>
+__forceinline
+void dispatch_table_impl<0, user_mode>::enter_detached() {
+    this->detach_.NtClose(this->detach_release_.handle);
+}
+#endif
+
 #ifdef SCFW_ENABLE_LOAD_MODULE
 template<>
 __forceinline
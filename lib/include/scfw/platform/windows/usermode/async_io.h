@@ -0,0 +1,274 @@
+#pragma once
+
+//
+// Overlapped I/O with completion-port batching.
+//
+// Submits `NtReadFile` / `NtWriteFile` requests without waiting for them,
+// and collects their results in batches with `NtRemoveIoCompletionEx`.
+// A payload can keep dozens of reads in flight on one thread instead of
+// blocking on each one in turn.
+//
+// Requires `SCFW_ENABLE_ASYNC_IO`.
+//
+//   uint8_t storage[1024];
+//   sc::arena arena{ storage, sizeof(storage) };
+//
+//   sc::async_io io;
+//   io.create(arena, 16);                     // up to 16 requests in flight
+//   io.associate(FileHandle);                 // opened WITHOUT FILE_SYNCHRONOUS_IO_*
+//   io.read(FileHandle, Buffer, 4096, 0, Buffer);
+//   io.read(FileHandle, Buffer + 4096, 4096, 4096, Buffer + 4096);
+//
+//   sc::io_completion done[16];
+//   while (io.pending()) {
+//       ULONG count = io.wait(done, 16);
+//       for (ULONG i = 0; i < count; i++) {
+//           // done[i].context, done[i].status, done[i].information
+//       }
+//   }
+//
+//   io.destroy();
+//
+// Every request lives in a table carved from the arena at `create()` time:
+// submitting and completing only pushes/pops a free list, with no
+// allocation and no lock (the object is meant to be driven from a single
+// thread). The request address doubles as the completion `ApcContext`,
+// which is how a dequeued packet finds its way back to the caller's
+// context.
+//
+// All requests must be drained (or cancelled and then drained) before
+// `destroy()` and before the arena's memory goes away - the kernel writes
+// the I/O status into the request table when an operation completes.
+//
+
+#include "../../../runtime/arena.h"
+#include "../usermode.h"
+
+#ifndef SCFW_ENABLE_ASYNC_IO
+#   error "async_io.h requires SCFW_ENABLE_ASYNC_IO"
+#endif
+
+namespace sc {
+
+//
+// Result of one finished request, as returned by `async_io::wait()`.
+//
+
+struct io_completion {
+    void* context;          // Value passed to `read()` / `write()`.
+    void* key;              // Value passed to `associate()` for the file.
+    NTSTATUS status;        // Final status of the operation.
+    ULONG_PTR information;  // Bytes transferred.
+};
+
+class async_io {
+public:
+    async_io() = default;
+    async_io(const async_io&) = delete;
+    async_io& operator=(const async_io&) = delete;
+
+    //
+    // Creates the completion port and carves the request table (and the
+    // dequeue scratch buffer) for `capacity` requests out of `storage`.
+    //
+
+    NTSTATUS create(arena& storage, ULONG capacity) {
+        auto& api = detail::base_table<detail::SCFW_MODE>()->fields().async_io_;
+
+        table_ = storage.allocate<request>(capacity);
+        entries_ = storage.allocate<FILE_IO_COMPLETION_INFORMATION>(capacity);
+
+        if (!table_ || !entries_) {
+            return STATUS_NO_MEMORY;
+        }
+
+        free_ = nullptr;
+        for (ULONG Index = capacity; Index--;) {
+            table_[Index].next = free_;
+            free_ = &table_[Index];
+        }
+
+        capacity_ = capacity;
+        pending_ = 0;
+
+        return api.NtCreateIoCompletion(&port_, IO_COMPLETION_ALL_ACCESS, NULL, 0);
+    }
+
+    //
+    // Closes the completion port. Requests still in flight must have been
+    // drained first (see above).
+    //
+
+    void destroy() {
+        if (port_) {
+            auto& api = detail::base_table<detail::SCFW_MODE>()->fields().async_io_;
+            api.NtClose(port_);
+            port_ = nullptr;
+        }
+    }
+
+    //
+    // Binds `file` to the completion port. Completions for this file report
+    // `key` in `io_completion::key`. A file can be bound to only one port,
+    // and only once.
+    //
+
+    NTSTATUS associate(HANDLE file, void* key = nullptr) {
+        auto& api = detail::base_table<detail::SCFW_MODE>()->fields().async_io_;
+
+        FILE_COMPLETION_INFORMATION CompletionInformation;
+        CompletionInformation.Port = port_;
+        CompletionInformation.Key = key;
+
+        IO_STATUS_BLOCK IoStatusBlock;
+        return api.NtSetInformationFile(file,
+                                        &IoStatusBlock,
+                                        &CompletionInformation,
+                                        sizeof(CompletionInformation),
+                                        FileCompletionInformation);
+    }
+
+    //
+    // Submit a read / write at `offset`. Returns `STATUS_PENDING` or a
+    // success code if a completion will be posted, or the failure status
+    // if the request was rejected up front (no completion is posted then).
+    // Returns `STATUS_INSUFFICIENT_RESOURCES` if all `capacity` requests
+    // are in flight.
+    //
+
+    __forceinline
+    NTSTATUS read(HANDLE file, void* buffer, ULONG length, ULONGLONG offset, void* context) {
+        return submit<false>(file, buffer, length, offset, context);
+    }
+
+    __forceinline
+    NTSTATUS write(HANDLE file, const void* buffer, ULONG length, ULONGLONG offset, void* context) {
+        return submit<true>(file, const_cast<void*>(buffer), length, offset, context);
+    }
+
+    //
+    // Cancels every request in flight for `file`. Cancelled requests still
+    // complete (with `STATUS_CANCELLED`) and must be collected by `wait()`.
+    //
+
+    NTSTATUS cancel(HANDLE file) {
+        auto& api = detail::base_table<detail::SCFW_MODE>()->fields().async_io_;
+
+        IO_STATUS_BLOCK IoStatusBlock;
+        return api.NtCancelIoFileEx(file, NULL, &IoStatusBlock);
+    }
+
+    //
+    // Dequeues up to `count` finished requests in one call and returns how
+    // many were written to `completions`. Blocks until at least one is
+    // available, or until `timeout` (NT relative/absolute time, `nullptr`
+    // waits forever) expires, in which case 0 is returned.
+    //
+
+    ULONG wait(io_completion* completions, ULONG count, PLARGE_INTEGER timeout = nullptr) {
+        auto& api = detail::base_table<detail::SCFW_MODE>()->fields().async_io_;
+
+        if (count > capacity_) {
+            count = capacity_;
+        }
+
+        ULONG Removed = 0;
+        NTSTATUS Status = api.NtRemoveIoCompletionEx(port_,
+                                                     entries_,
+                                                     count,
+                                                     &Removed,
+                                                     timeout,
+                                                     FALSE);
+
+        if (Status != STATUS_SUCCESS) {
+            return 0;
+        }
+
+        for (ULONG Index = 0; Index < Removed; Index++) {
+            auto Request = static_cast<request*>(entries_[Index].ApcContext);
+
+            completions[Index].context = Request->context;
+            completions[Index].key = entries_[Index].KeyContext;
+            completions[Index].status = entries_[Index].IoStatusBlock.Status;
+            completions[Index].information = entries_[Index].IoStatusBlock.Information;
+
+            release(Request);
+        }
+
+        return Removed;
+    }
+
+    //
+    // Number of requests submitted but not yet returned by `wait()`.
+    //
+
+    __forceinline
+    ULONG pending() const {
+        return pending_;
+    }
+
+private:
+    struct request {
+        IO_STATUS_BLOCK io_status;
+        void* context;
+        request* next;
+    };
+
+    template <bool Write>
+    NTSTATUS submit(HANDLE file, void* buffer, ULONG length, ULONGLONG offset, void* context) {
+        auto& api = detail::base_table<detail::SCFW_MODE>()->fields().async_io_;
+
+        request* Request = free_;
+        if (!Request) {
+            return STATUS_INSUFFICIENT_RESOURCES;
+        }
+
+        free_ = Request->next;
+        pending_++;
+
+        Request->context = context;
+
+        LARGE_INTEGER ByteOffset;
+        ByteOffset.QuadPart = static_cast<LONGLONG>(offset);
+
+        //
+        // No event and no APC routine: with the file bound to a completion
+        // port, `ApcContext` is what the dequeued packet carries back.
+        //
+
+        NTSTATUS Status;
+        if constexpr (Write) {
+            Status = api.NtWriteFile(file, NULL, NULL, Request, &Request->io_status,
+                                     buffer, length, &ByteOffset, NULL);
+        } else {
+            Status = api.NtReadFile(file, NULL, NULL, Request, &Request->io_status,
+                                    buffer, length, &ByteOffset, NULL);
+        }
+
+        //
+        // Requests that fail immediately never reach the port.
+        //
+
+        if (NT_ERROR(Status)) {
+            release(Request);
+        }
+
+        return Status;
+    }
+
+    __forceinline
+    void release(request* Request) {
+        Request->next = free_;
+        free_ = Request;
+        pending_--;
+    }
+
+    HANDLE port_{};
+    request* table_{};
+    request* free_{};
+    FILE_IO_COMPLETION_INFORMATION* entries_{};
+    ULONG capacity_{};
+    ULONG pending_{};
+};
+
+} // namespace sc
@@ -0,0 +1,175 @@
+#pragma once
+
+//
+// Zero-copy, read-only file mapping.
+//
+// Maps a whole file into the address space with `NtCreateFile` +
+// `NtCreateSection` + `NtMapViewOfSection` and exposes it as a span.
+// Nothing is copied into an intermediate buffer, and no kernel32 import
+// (`CreateFileA`, `ReadFile`, `VirtualAlloc`, ...) is needed: the native
+// functions are resolved from ntdll during the base `init()`.
+//
+// Requires `SCFW_ENABLE_MAPPED_FILE`.
+//
+//   sc::mapped_file file;
+//   if (NT_SUCCESS(file.open(_T(L"\\??\\C:\\Windows\\win.ini")))) {
+//       for (uint8_t byte : file.view()) { ... }
+//   }
+//   // The view is unmapped by the destructor (or an explicit `destroy()`).
+//
+// The path is an NT path (`\??\C:\...`), not a Win32 one - no path
+// translation is done, as that would need `RtlDosPathNameToNtPathName_U`.
+//
+
+#include <span>
+
+#include "../usermode.h"
+
+#ifndef SCFW_ENABLE_MAPPED_FILE
+#   error "mapped_file.h requires SCFW_ENABLE_MAPPED_FILE"
+#endif
+
+namespace sc {
+
+class mapped_file {
+public:
+    mapped_file() = default;
+    mapped_file(const mapped_file&) = delete;
+    mapped_file& operator=(const mapped_file&) = delete;
+
+    __forceinline
+    ~mapped_file() {
+        destroy();
+    }
+
+    //
+    // Opens `path` for reading and maps its contents. Any view held by this
+    // object is unmapped first. An empty file succeeds with an empty view
+    // (sections cannot be created over zero-length files).
+    //
+
+    NTSTATUS open(const wchar_t* path) {
+        auto& api = detail::base_table<detail::SCFW_MODE>()->fields().mapped_file_;
+
+        destroy();
+
+        UNICODE_STRING Name;
+        Name.Length = static_cast<USHORT>(wcslen(path) * sizeof(wchar_t));
+        Name.MaximumLength = Name.Length;
+        Name.Buffer = const_cast<PWCH>(path);
+
+        OBJECT_ATTRIBUTES ObjectAttributes;
+        InitializeObjectAttributes(&ObjectAttributes, &Name, OBJ_CASE_INSENSITIVE, NULL, NULL);
+
+        NTSTATUS Status;
+        HANDLE FileHandle;
+        IO_STATUS_BLOCK IoStatusBlock;
+        Status = api.NtCreateFile(&FileHandle,
+                                  FILE_GENERIC_READ,
+                                  &ObjectAttributes,
+                                  &IoStatusBlock,
+                                  NULL,
+                                  FILE_ATTRIBUTE_NORMAL,
+                                  FILE_SHARE_READ,
+                                  FILE_OPEN,
+                                  FILE_NON_DIRECTORY_FILE | FILE_SYNCHRONOUS_IO_NONALERT,
+                                  NULL,
+                                  0);
+
+        if (!NT_SUCCESS(Status)) {
+            return Status;
+        }
+
+        FILE_STANDARD_INFORMATION StandardInformation;
+        Status = api.NtQueryInformationFile(FileHandle,
+                                            &IoStatusBlock,
+                                            &StandardInformation,
+                                            sizeof(StandardInformation),
+                                            FileStandardInformation);
+
+        if (NT_SUCCESS(Status) &&
+            static_cast<ULONGLONG>(StandardInformation.EndOfFile.QuadPart) > SIZE_MAX) {
+            //
+            // Only reachable on x86: the whole file has to fit in one view.
+            //
+
+            Status = STATUS_SECTION_TOO_BIG;
+        }
+
+        if (NT_SUCCESS(Status) && StandardInformation.EndOfFile.QuadPart != 0) {
+            HANDLE SectionHandle;
+            Status = api.NtCreateSection(&SectionHandle,
+                                         SECTION_MAP_READ | SECTION_QUERY,
+                                         NULL,
+                                         NULL,
+                                         PAGE_READONLY,
+                                         SEC_COMMIT,
+                                         FileHandle);
+
+            if (NT_SUCCESS(Status)) {
+                PVOID BaseAddress = NULL;
+                SIZE_T ViewSize = 0;
+                Status = api.NtMapViewOfSection(SectionHandle,
+                                                NtCurrentProcess(),
+                                                &BaseAddress,
+                                                0,
+                                                0,
+                                                NULL,
+                                                &ViewSize,
+                                                ViewUnmap,
+                                                0,
+                                                PAGE_READONLY);
+
+                if (NT_SUCCESS(Status)) {
+                    base_ = static_cast<const uint8_t*>(BaseAddress);
+                    size_ = static_cast<size_t>(StandardInformation.EndOfFile.QuadPart);
+                }
+
+                //
+                // The view keeps its own reference to the section (and the
+                // section to the file), so neither handle is needed anymore.
+                //
+
+                api.NtClose(SectionHandle);
+            }
+        }
+
+        api.NtClose(FileHandle);
+        return Status;
+    }
+
+    //
+    // Unmaps the view, if any. Safe to call more than once.
+    //
+
+    void destroy() {
+        if (base_) {
+            auto& api = detail::base_table<detail::SCFW_MODE>()->fields().mapped_file_;
+            api.NtUnmapViewOfSection(NtCurrentProcess(), const_cast<uint8_t*>(base_));
+
+            base_ = nullptr;
+            size_ = 0;
+        }
+    }
+
+    //
+    // The file contents. Exactly the file size - the page-granular tail of
+    // the view is not part of the span.
+    //
+
+    __forceinline
+    std::span<const uint8_t> view() const {
+        return { base_, size_ };
+    }
+
+    __forceinline
+    explicit operator bool() const {
+        return base_ != nullptr;
+    }
+
+private:
+    const uint8_t* base_{};
+    size_t size_{};
+};
+
+} // namespace sc
@@ -0,0 +1,148 @@
+#pragma once
+
+//
+// Data-parallel loop over the native thread pool.
+//
+// `sc::parallel_for(begin, end, grain, fn)` splits `[begin, end)` into
+// chunks of `grain` indices and runs them on the process thread pool
+// (`TpAllocWork` / `TpPostWork`), with the calling thread pitching in.
+// Chunks are claimed from a shared counter, so a worker that finishes
+// early simply takes the next chunk instead of idling behind a slow one.
+//
+// Requires `SCFW_ENABLE_PARALLEL_FOR`.
+//
+//   sc::parallel_for(0, BlockCount, 16, [&](size_t Index) {
+//       Digests[Index] = hash_block(Data + Index * BlockSize);
+//   });
+//
+//   // Or take a whole chunk at once:
+//   sc::parallel_for(0, Size, 64 * 1024, [&](size_t Begin, size_t End) {
+//       scan(Data + Begin, End - Begin);
+//   });
+//
+// The call is a barrier: it returns only after `TpWaitForWork` has seen
+// every posted callback finish. No thread pool worker is ever left running
+// shellcode, which is what makes it safe with `SCFW_ENABLE_CLEANUP` -
+// by the time `entry()` (and then `_entry`) returns, there is nothing left
+// that could execute in the memory `_cleanup_*` is about to free.
+//
+// If the work object cannot be allocated, the loop runs on the calling
+// thread alone.
+//
+
+#include <type_traits>
+
+#include "../usermode.h"
+
+#ifndef SCFW_ENABLE_PARALLEL_FOR
+#   error "parallel_for.h requires SCFW_ENABLE_PARALLEL_FOR"
+#endif
+
+namespace sc {
+namespace detail {
+
+template <typename F>
+struct parallel_for_context {
+    F* fn;
+    size_t next;
+    size_t end;
+    size_t grain;
+};
+
+//
+// Claims chunks until the range is exhausted. Runs on the pool workers and
+// on the calling thread.
+//
+
+template <typename F>
+void parallel_for_run(parallel_for_context<F>* context) {
+    for (;;) {
+        size_t Begin = __atomic_fetch_add(&context->next, context->grain, __ATOMIC_RELAXED);
+        if (Begin >= context->end) {
+            break;
+        }
+
+        size_t End = context->end - Begin > context->grain
+            ? Begin + context->grain
+            : context->end;
+
+        if constexpr (std::is_invocable_v<F&, size_t, size_t>) {
+            (*context->fn)(Begin, End);
+        } else {
+            for (size_t Index = Begin; Index < End; Index++) {
+                (*context->fn)(Index);
+            }
+        }
+    }
+}
+
+template <typename F>
+VOID NTAPI parallel_for_callback(PTP_CALLBACK_INSTANCE Instance, PVOID Context, PTP_WORK Work) {
+    (void)Instance;
+    (void)Work;
+
+    parallel_for_run(static_cast<parallel_for_context<F>*>(Context));
+}
+
+} // namespace detail
+
+template <typename F>
+void parallel_for(size_t begin, size_t end, size_t grain, F&& fn) {
+    using function_type = std::remove_reference_t<F>;
+
+    auto& api = detail::base_table<detail::SCFW_MODE>()->fields().parallel_for_;
+
+    if (begin >= end) {
+        return;
+    }
+
+    if (!grain) {
+        grain = 1;
+    }
+
+    detail::parallel_for_context<function_type> Context;
+    Context.fn = &fn;
+    Context.next = begin;
+    Context.end = end;
+    Context.grain = grain;
+
+    //
+    // One callback per additional processor, but never more than there are
+    // chunks beyond the one the calling thread takes.
+    //
+
+    size_t Chunks = (end - begin - 1) / grain + 1;
+    size_t Workers = NtCurrentPeb()->NumberOfProcessors;
+
+    if (Workers > Chunks) {
+        Workers = Chunks;
+    }
+
+    PTP_WORK Work = nullptr;
+    if (Workers > 1) {
+        PTP_WORK_CALLBACK Callback = _(&detail::parallel_for_callback<function_type>);
+        if (!NT_SUCCESS(api.TpAllocWork(&Work, Callback, &Context, NULL))) {
+            Work = nullptr;
+        }
+    }
+
+    if (Work) {
+        for (size_t Index = 1; Index < Workers; Index++) {
+            api.TpPostWork(Work);
+        }
+    }
+
+    detail::parallel_for_run(&Context);
+
+    if (Work) {
+        //
+        // Barrier. Also waits for callbacks that were posted but found the
+        // range already drained, so nothing references `Context` after this.
+        //
+
+        api.TpWaitForWork(Work, FALSE);
+        api.TpReleaseWork(Work);
+    }
+}
+
+} // namespace sc
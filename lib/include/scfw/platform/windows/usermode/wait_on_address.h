@@ -0,0 +1,63 @@
+#pragma once
+
+//
+// `RtlWaitOnAddress`-based waiter policy for the primitives in
+// `runtime/sync.h`.
+//
+// Parks contended threads in the kernel instead of burning a core, without
+// importing critical sections or creating event objects - the wait is keyed
+// by the address of the lock word itself.
+//
+// Requires `SCFW_ENABLE_WAIT_ON_ADDRESS`.
+//
+//   sc::spinlock<sc::wait_on_address> Lock;
+//
+//   {
+//       sc::lock_guard Guard{ Lock };
+//       ...
+//   }
+//
+// `RtlWaitOnAddress` exists since Windows 8. On older systems the exports
+// are missing, init leaves the pointers null, and the policy quietly falls
+// back to `sc::spin_waiter`.
+//
+
+#include "../../../runtime/sync.h"
+#include "../usermode.h"
+
+#ifndef SCFW_ENABLE_WAIT_ON_ADDRESS
+#   error "wait_on_address.h requires SCFW_ENABLE_WAIT_ON_ADDRESS"
+#endif
+
+namespace sc {
+
+struct wait_on_address {
+    template <typename T>
+    static void wait(T* address, T expected) {
+        auto& api = detail::base_table<detail::SCFW_MODE>()->fields().wait_on_address_;
+
+        if (api.RtlWaitOnAddress) {
+            api.RtlWaitOnAddress(address, &expected, sizeof(T), NULL);
+        } else {
+            spin_waiter::wait(address, expected);
+        }
+    }
+
+    static void wake_one(void* address) {
+        auto& api = detail::base_table<detail::SCFW_MODE>()->fields().wait_on_address_;
+
+        if (api.RtlWakeAddressSingle) {
+            api.RtlWakeAddressSingle(address);
+        }
+    }
+
+    static void wake_all(void* address) {
+        auto& api = detail::base_table<detail::SCFW_MODE>()->fields().wait_on_address_;
+
+        if (api.RtlWakeAddressAll) {
+            api.RtlWakeAddressAll(address);
+        }
+    }
+};
+
+} // namespace sc
@@ -45,6 +45,30 @@
 //                               via CMake (not just #define) because the
 //                               assembly startup code depends on it too.
 //
+//   SCFW_ENABLE_DETACH        - Detached execution: `_entry` initializes the
+//                               dispatch table, starts a new thread for the
+//                               user's entry() and returns to the caller
+//                               right away. The thread is held back until
+//                               the caller has left the shellcode. With
+//                               SCFW_ENABLE_CLEANUP, the new thread frees
+//                               the shellcode when done (the caller's
+//                               thread, if there is no new thread). MUST
+//                               be set via CMake (SCFW_OPT_DETACH).
+//
+//   SCFW_ENABLE_RESULT        - entry() returns a `uintptr_t` status, which
+//                               `_entry` returns to the caller and stores,
+//                               together with the hash of the import that
+//                               failed `init()`, through an optional third
+//                               argument (`sc::entry_result*`). MUST be set
+//                               via CMake (SCFW_OPT_RESULT). Not compatible
+//                               with SCFW_ENABLE_DETACH.
+//
+//   SCFW_ENABLE_COMPLETION_SIGNAL - `_entry` ends with an instruction that
+//                               traps to a VMI host (`cpuid`, `vmcall`,
+//                               `int3` or a write to a watched page), with
+//                               the status and result pointer in registers.
+//                               See `runtime/completion.h`.
+//
 //   SCFW_ENABLE_LOAD_MODULE   - Resolves LoadLibraryA at init time. Required
 //                               by SCFW_FLAG_DYNAMIC_LOAD to load DLLs not
 //                               already present in the target process.
@@ -61,6 +85,38 @@
 //                               symbol name strings from appearing in
 //                               plaintext in the binary.
 //
+//   SCFW_ENABLE_PINNED_RVAS   - Resolves symbols of known module builds from
+//                               an offline export database (module + RVA)
+//                               instead of walking the export table. See
+//                               `runtime/pinned.h`.
+//
+//   SCFW_ENABLE_SCAVENGE_IAT  - Locates the image whose import table
+//                               SCFW_FLAG_SCAVENGE_IAT entries are taken
+//                               from (SCFW_SCAVENGE_IAT_MODULE, default:
+//                               the process image / ntoskrnl).
+//
+//   SCFW_ENABLE_COMPACT_SLOTS - x64: callable imports store a 32-bit offset
+//                               from their module's base instead of an
+//                               8-byte pointer, and entries are packed to
+//                               4 bytes. Halves the table for import-heavy
+//                               payloads; each call adds the module base.
+//                               No effect on x86.
+//
+//   SCFW_ENABLE_INIT_CONTEXT  - `IMPORT_MODULE` handles only stay in the
+//                               dispatch table if they are needed after
+//                               init (DYNAMIC_UNLOAD, compact slots); the
+//                               others only live in the init context on
+//                               `_entry`'s stack, as do the IAT source
+//                               and the kernel-mode module snapshot.
+//                               Smaller table, denser slots. See
+//                               `MEMORY LAYOUT`.
+//
+//   SCFW_ENABLE_IMPORT_THUNKS - x86: calls to an import go through one
+//                               shared thunk per import that locates the
+//                               slot and tail-jumps through it, so call
+//                               sites shrink to a `call rel32`. No effect
+//                               on x64 (`call [rip+slot]` already).
+//
 // PER-ENTRY FLAGS (passed via FLAGS() in IMPORT_MODULE / IMPORT_SYMBOL):
 //
 //   SCFW_FLAG_DYNAMIC_RESOLVE - Use GetProcAddress for symbol lookup instead
@@ -86,6 +142,18 @@
 //     (0x10)                    instead of FNV-1a hash. Larger output
 //                               (full symbol name string in binary).
 //
+//   SCFW_FLAG_SCAVENGE_IAT    - Read the symbol from the IAT of an already
+//     (0x20)                    loaded image that imports it by name, and
+//                               only search the export table if it does
+//                               not. Set on a module to affect all its
+//                               symbols. Requires SCFW_ENABLE_SCAVENGE_IAT.
+//
+//   SCFW_FLAG_DEREFERENCE     - Value imports only: read the exported
+//     (0x40)                    variable once during init and store its
+//                               value instead of its address. `sc::Name`
+//                               then is the value (`POBJECT_TYPE` for
+//                               `IMPORT_SYMBOL(Name, POBJECT_TYPE*, ...)`).
+//
 // DEFAULT FLAGS (define before including runtime.h):
 //
 //   SCFW_MODULE_DEFAULT_FLAGS - Default flags for IMPORT_MODULE (default: 0).
@@ -105,17 +173,21 @@
 //     - provides find_module(), load_module(), lookup_symbol()
 //           |
 //   dispatch_table_impl<1, Mode>    IMPORT_MODULE("kernel32.dll")
-//     - adds: void* module_
+//     - adds: void* module_ (see module_holder)
 //     - init() calls find_module() or load_module()
 //     - destroy() optionally calls unload_module()
 //           |
 //   dispatch_table_impl<2, Mode>    IMPORT_SYMBOL(Sleep)
 //     - adds: slot_Sleep_ (function pointer)
-//     - init() calls lookup_symbol() on parent's module_
+//     - init() calls lookup_symbol() on the module the last
+//       IMPORT_MODULE put into the init context
 //           |
 //   dispatch_table                  final alias (defined by IMPORT_END)
 //
-// init() chains upward: base first, then each entry in order.
+// init() chains upward: base first, then each entry in order. The
+// init_context passed along lives on _entry's stack and carries what is
+// only needed during init (the current module, its pinned build; with
+// SCFW_ENABLE_INIT_CONTEXT also the IAT source and module snapshot).
 // destroy() chains downward: last entry first, back to base.
 //
 // After IMPORT_END, user code accesses symbols through proxy objects
@@ -133,7 +205,8 @@
 //   ------------- ------------------------- -------------------------
 //   .text$00      _init                     lib/src/arch/*/init.S
 //   .text$10      _start, _pc, _cleanup_*   lib/src/arch/*/start.S
-//   .text$20      _entry                    IMPORT_END() macro
+//   .text$10      _detach, _start_thread    lib/src/arch/*/detach.S
+//   .text$20      _entry, _entry_thread     IMPORT_END() macro
 //   .text$aaa     framework code            runtime.h, crt0.h, etc.
 //   .text$yyy     user code                 after IMPORT_END()
 //
@@ -157,6 +230,37 @@
 //
 // IMPORTANT: DO NOT reorder these members without updating assembly!
 //
+// With `SCFW_ENABLE_COMPACT_SLOTS` on x64, the entries that follow the
+// base are packed to 4 bytes, and callable `IMPORT_SYMBOL` slots are
+// `int32_t` offsets from their module's `module_`:
+//
+//   +-------------------------+
+//   | base (as above)         |
+//   | module_ (kernel32)      |  8 bytes
+//   | slot_Sleep_             |  4 bytes: Sleep - module_
+//   | slot_ExitProcess_       |  4 bytes
+//   | module_ (user32)        |  8 bytes
+//   | ...                     |
+//   +-------------------------+
+//
+// A call loads `module_`, sign-extends the slot and adds the two. A
+// symbol that resolves more than 2 GB away from its module's base (a
+// forwarded export or IAT entry pointing into another module) cannot be
+// stored and fails init like an unresolved one. Value imports keep full
+// pointers, since their proxies hand out the slot's address.
+//
+// With `SCFW_ENABLE_INIT_CONTEXT`, `module_` is only there for modules
+// that need it after init (`DYNAMIC_LOAD | DYNAMIC_UNLOAD`, or all of them
+// with compact slots); the table is then mostly slots:
+//
+//   +-------------------------+
+//   | base (as above)         |
+//   | slot_Sleep_             |  kernel32 (found during init only)
+//   | slot_ExitProcess_       |
+//   | module_ (user32)        |  DYNAMIC_LOAD | DYNAMIC_UNLOAD
+//   | slot_MessageBoxA_       |
+//   +-------------------------+
+//
 
 //
 // Place all framework code in `.text$aaa` (after `_entry` in `.text$20`,
@@ -164,9 +268,13 @@
 //
 #pragma code_seg(".text$aaa")
 
+#include <utility>
+
 #include "crt0.h"
+#include "runtime/completion.h"
 #include "runtime/fnv1a.h"
 #include "runtime/pic.h"
+#include "runtime/pinned.h"
 #include "runtime/xorstr.h"
 
 //=============================================================================
@@ -205,6 +313,31 @@
 //
 #define SCFW_FLAG_STRING_SYMBOL   0x10
 
+//
+// Take the symbol from the import address table of an already loaded image
+// (`SCFW_SCAVENGE_IAT_MODULE`) that imports it from this module by name;
+// fall back to the export table on a miss. Set on a module to affect all
+// its symbols. Requires `SCFW_ENABLE_SCAVENGE_IAT`.
+//
+// The import has to name the module itself: imports through API sets
+// ("api-ms-win-core-...") do not match "kernel32.dll". Forwarded exports
+// yield their final target.
+//
+#define SCFW_FLAG_SCAVENGE_IAT    0x20
+
+//
+// Value imports: read the exported variable during `init()` and keep a
+// copy of its value in the dispatch table instead of its address, which
+// saves a load (and, on x86, nothing else needs the address) per access.
+// The type passed to `IMPORT_SYMBOL` stays the export's address type, e.g.
+// `IMPORT_SYMBOL(PsProcessType, POBJECT_TYPE*, FLAGS(...))` makes
+// `sc::PsProcessType` a `POBJECT_TYPE`.
+//
+// Only for variables that do not change after init: later changes to the
+// export are not seen, and writes through `sc::Name` only change the copy.
+//
+#define SCFW_FLAG_DEREFERENCE     0x40
+
 //
 // Default flags for `IMPORT_MODULE` / `IMPORT_SYMBOL` when `FLAGS()` is not specified.
 // Override these before including `runtime.h` if you want all entries to share
@@ -218,11 +351,70 @@
 #   define SCFW_ENTRY_DEFAULT_FLAGS 0
 #endif
 
+//
+// Compact slots (see `MEMORY LAYOUT`). On x86 a pointer already is 4 bytes.
+//
+#if defined(SCFW_ENABLE_COMPACT_SLOTS) && !defined(_M_IX86)
+#   define SCFW__COMPACT_SLOTS true
+#   define SCFW__PACK_BEGIN _Pragma("pack(push, 4)")
+#   define SCFW__PACK_END   _Pragma("pack(pop)")
+#else
+#   define SCFW__COMPACT_SLOTS false
+#   define SCFW__PACK_BEGIN
+#   define SCFW__PACK_END
+#endif
+
+#ifdef SCFW_ENABLE_RESULT
+#   ifdef SCFW_ENABLE_DETACH
+#       error "SCFW_ENABLE_RESULT cannot be combined with SCFW_ENABLE_DETACH"
+#   endif
+
+namespace sc {
+
+//
+// Filled in by `_entry` when the caller passes a pointer to one as the
+// third argument (R8 on x64, on the stack on x86):
+//
+//   status         - entry()'s return value, or `SCFW_RESULT_INIT_FAILED`
+//                    if the dispatch table could not be initialized.
+//   failed_import  - FNV-1a hash of the module or symbol name `init()`
+//                    failed on (as `fnv1a_hash("kernel32.dll")`), or 0.
+//
+// With cleanup, the caller's return register holds the result of
+// `VirtualFree` / `ExFreePool`, so this is the only way to get the status.
+//
+
+struct entry_result {
+    uintptr_t status;
+    uint32_t failed_import;
+};
+
+} // namespace sc
+
+#define SCFW_RESULT_INIT_FAILED (~uintptr_t{ 0 })
+
+//
+// User-defined entry point. Called by the framework after the dispatch table
+// is initialized. Must be implemented by the user. The return value is
+// handed back to the caller.
+//
+extern "C" uintptr_t __fastcall entry(void* argument1, void* argument2);
+#else
 //
 // User-defined entry point. Called by the framework after the dispatch table
 // is initialized. Must be implemented by the user.
 //
 extern "C" void __fastcall entry(void* argument1, void* argument2);
+#endif
+
+#ifdef SCFW_ENABLE_DETACH
+//
+// Thread start routine for detached execution. Implemented in assembly
+// (`detach.S`); runs `_entry_thread` on the new thread, through `_start`
+// when cleanup is enabled.
+//
+extern "C" void __stdcall _start_thread(void* parameter);
+#endif
 
 //
 // FLAGS() macro for passing per-entry flags to `IMPORT_MODULE` / `IMPORT_SYMBOL`.
@@ -259,26 +451,121 @@ extern "C" void __fastcall entry(void* argument1, void* argument2);
 //     - calls `dt->destroy()` for cleanup (e.g., `FreeLibrary`).
 // - Switches to `.text$yyy` so all subsequent user code goes there.
 //
+// With `SCFW_ENABLE_DETACH`, `_entry()` stops after `dt->init()`: it hands
+// the arguments to `dt->detach()`, which starts a thread at `_start_thread`
+// that is held back, and returns how to release it (`detach_release`), or
+// `nullptr` if there is no thread. `_detach` (`detach.S`) then tail-jumps to
+// the release routine, so the caller's thread is out of the shellcode
+// before the new one can free it. The thread runs `_entry_thread()`, which
+// calls `dt->enter_detached()`, `entry()` and `dt->destroy()` on its own.
+//
+// With `SCFW_ENABLE_RESULT`, `_entry()` takes the caller's `entry_result*`
+// as a third argument and returns `entry()`'s status, or
+// `SCFW_RESULT_INIT_FAILED` without calling `entry()` if `dt->init()`
+// failed.
+//
+// With `SCFW_ENABLE_COMPLETION_SIGNAL`, the last thing `entry()`'s thread
+// does in here is `SCFW_SIGNAL_COMPLETION()` (see `runtime/completion.h`).
+//
 
-#define IMPORT_END()                                                          \
-    namespace sc {                                                            \
-    namespace detail {                                                        \
-    struct dispatch_table                                                     \
-        : dispatch_table_impl<__COUNTER__, SCFW_MODE> {};                     \
-    extern "C" dispatch_table __dispatch_table{};                             \
+#if defined(SCFW_ENABLE_RESULT)
+#define SCFW_ENTRY_IMPL()                                                     \
+    __pragma(code_seg(".text$20"))                                            \
+    __declspec(allocate(".text$20"))                                          \
+    extern "C" uintptr_t __fastcall _entry(void* argument1, void* argument2,  \
+                                           entry_result* result) {            \
+        auto dt = reinterpret_cast<dispatch_table*>(_(&__dispatch_table));    \
+                                                                              \
+        uintptr_t status = SCFW_RESULT_INIT_FAILED;                           \
+        uint32_t failed_import = 0;                                           \
                                                                               \
+        init_context<SCFW_MODE> context{};                                    \
+        auto err = dt->init(context, argument1, argument2);                   \
+        dt->finish_init(context);                                             \
+        if (err) {                                                            \
+            failed_import =                                                   \
+                import_hash<dispatch_table::entry_id, SCFW_MODE>(err);        \
+        } else {                                                              \
+            status = entry(argument1, argument2);                             \
+            dt->destroy(argument1, argument2);                                \
+        }                                                                     \
+                                                                              \
+        if (result) {                                                         \
+            result->status = status;                                          \
+            result->failed_import = failed_import;                            \
+        }                                                                     \
+                                                                              \
+        SCFW_SIGNAL_COMPLETION(status, result);                               \
+        return status;                                                        \
+    }
+#elif !defined(SCFW_ENABLE_DETACH)
+#define SCFW_ENTRY_IMPL()                                                     \
     __pragma(code_seg(".text$20"))                                            \
     __declspec(allocate(".text$20"))                                          \
     extern "C" void __fastcall _entry(void* argument1, void* argument2) {     \
         auto dt = reinterpret_cast<dispatch_table*>(_(&__dispatch_table));    \
                                                                               \
-        auto err = dt->init(argument1, argument2);                            \
-        if (err) return;                                                      \
+        init_context<SCFW_MODE> context{};                                    \
+        auto err = dt->init(context, argument1, argument2);                   \
+        dt->finish_init(context);                                             \
+        if (err) {                                                            \
+            SCFW_SIGNAL_COMPLETION(err, nullptr);                             \
+            return;                                                           \
+        }                                                                     \
                                                                               \
         entry(argument1, argument2);                                          \
                                                                               \
         dt->destroy(argument1, argument2);                                    \
+        SCFW_SIGNAL_COMPLETION(0, nullptr);                                   \
+    }
+#else
+#define SCFW_ENTRY_IMPL()                                                     \
+    __pragma(code_seg(".text$20"))                                            \
+    __declspec(allocate(".text$20"))                                          \
+    extern "C" const detach_release* __fastcall _entry(void* argument1,       \
+                                                       void* argument2) {     \
+        auto dt = reinterpret_cast<dispatch_table*>(_(&__dispatch_table));    \
+                                                                              \
+        init_context<SCFW_MODE> context{};                                    \
+        auto err = dt->init(context, argument1, argument2);                   \
+        dt->finish_init(context);                                             \
+        if (err) {                                                            \
+            SCFW_SIGNAL_COMPLETION(err, nullptr);                             \
+            return nullptr;                                                   \
+        }                                                                     \
+                                                                              \
+        err = dt->detach(argument1, argument2);                               \
+        if (err) {                                                            \
+            dt->destroy(argument1, argument2);                                \
+            SCFW_SIGNAL_COMPLETION(err, nullptr);                             \
+            return nullptr;                                                   \
+        }                                                                     \
+                                                                              \
+        return &dt->fields().detach_release_;                                 \
     }                                                                         \
+                                                                              \
+    extern "C" void __fastcall _entry_thread() {                              \
+        auto dt = reinterpret_cast<dispatch_table*>(_(&__dispatch_table));    \
+        dt->enter_detached();                                                 \
+                                                                              \
+        auto argument1 = dt->fields().detach_argument1_;                      \
+        auto argument2 = dt->fields().detach_argument2_;                      \
+                                                                              \
+        entry(argument1, argument2);                                          \
+                                                                              \
+        dt->destroy(argument1, argument2);                                    \
+        SCFW_SIGNAL_COMPLETION(0, nullptr);                                   \
+    }
+#endif
+
+#define IMPORT_END()                                                          \
+    namespace sc {                                                            \
+    namespace detail {                                                        \
+    struct dispatch_table                                                     \
+        : dispatch_table_impl<__COUNTER__, SCFW_MODE> {};                     \
+    extern "C" dispatch_table __dispatch_table{};                             \
+                                                                              \
+    SCFW_ENTRY_IMPL()                                                         \
     } /* namespace detail */                                                  \
     } /* namespace sc */                                                      \
                                                                               \
@@ -312,30 +599,41 @@ extern "C" void __fastcall entry(void* argument1, void* argument2);
 #define SCFW_IMPORT_MODULE_IMPL(Id, Module, Flags)                            \
     namespace sc {                                                            \
     namespace detail {                                                        \
+    SCFW__PACK_BEGIN                                                          \
     template<>                                                                \
     struct dispatch_table_impl<Id + 1, SCFW_MODE>                             \
-        : dispatch_table_impl<Id, SCFW_MODE>                                  \
+        : module_holder<dispatch_table_impl<Id, SCFW_MODE>,                   \
+                        module_persistent(Flags)>                             \
     {                                                                         \
         static_assert(!(((Flags) & SCFW_FLAG_DYNAMIC_UNLOAD) &&               \
                        !((Flags) & SCFW_FLAG_DYNAMIC_LOAD)),                  \
             Module ": DYNAMIC_UNLOAD requires DYNAMIC_LOAD");                 \
+        static_assert(!((Flags) & SCFW_FLAG_DEREFERENCE),                     \
+            Module ": DEREFERENCE can only be used with IMPORT_SYMBOL");      \
                                                                               \
+        static constexpr size_t entry_id = Id + 1;                            \
         static constexpr entry_kind entry_type = entry_kind::module;          \
         static constexpr uint32_t module_flags = Flags;                       \
+        static constexpr uint32_t module_hash = fnv1a_hash(Module);           \
                                                                               \
         __forceinline                                                         \
-        int init(void* argument1, void* argument2) {                          \
-            auto err = dispatch_table_impl<Id, SCFW_MODE>::init(argument1,    \
+        int init(init_context<SCFW_MODE>& context,                            \
+                 void* argument1, void* argument2) {                          \
+            auto err = dispatch_table_impl<Id, SCFW_MODE>::init(context,      \
+                                                                argument1,    \
                                                                 argument2);   \
             if (err) return err;                                              \
             if constexpr (module_flags & SCFW_FLAG_DYNAMIC_LOAD) {            \
-                module_ = load_module(_T(Module));                            \
+                context.module = load_module(_T(Module));                     \
             } else if constexpr (module_flags & SCFW_FLAG_STRING_MODULE) {    \
-                module_ = find_module(_T(Module));                            \
+                context.module = find_module(_T(Module));                     \
             } else {                                                          \
-                module_ = find_module(fnv1a_hash(Module));                    \
+                context.module = find_module(fnv1a_hash(Module));             \
             }                                                                 \
-            if (!module_) return Id + 1;                                      \
+            if (!context.module) return Id + 1;                               \
+            context.pinned_build = 0;                                         \
+            SCFW_PINNED_MODULE_INIT(Module)                                   \
+            this->hold_module(context.module);                                \
             return 0;                                                         \
         }                                                                     \
                                                                               \
@@ -343,23 +641,15 @@ extern "C" void __fastcall entry(void* argument1, void* argument2);
         void destroy(void* argument1, void* argument2) {                      \
             if constexpr ((module_flags & SCFW_FLAG_DYNAMIC_LOAD) &&          \
                           (module_flags & SCFW_FLAG_DYNAMIC_UNLOAD)) {        \
-                if (module_) {                                                \
+                if (current_module()) {                                       \
                     unload_module(current_module());                          \
                 }                                                             \
             }                                                                 \
             dispatch_table_impl<Id, SCFW_MODE>::destroy(argument1,            \
                                                         argument2);           \
         }                                                                     \
-                                                                              \
-    protected:                                                                \
-        __forceinline                                                         \
-        void* current_module() const {                                        \
-            return module_;                                                   \
-        }                                                                     \
-                                                                              \
-    private:                                                                  \
-        void* module_{};                                                      \
     };                                                                        \
+    SCFW__PACK_END                                                            \
     } /* namespace detail */                                                  \
     } /* namespace sc */
 
@@ -409,7 +699,8 @@ extern "C" void __fastcall entry(void* argument1, void* argument2);
 //
 
 #define SCFW_IMPORT_SYMBOL_CALLABLE_IMPL(Id, Name, Flags)                     \
-    SCFW_IMPORT_SYMBOL(Id, Name, decltype(&::Name), Flags);                   \
+    SCFW_IMPORT_SYMBOL(Id, Name, decltype(&::Name), Flags,                    \
+                       SCFW__COMPACT_SLOTS);                                  \
     SCFW_CALLABLE_IMPL(Id, Name)
 
 //
@@ -418,7 +709,7 @@ extern "C" void __fastcall entry(void* argument1, void* argument2);
 //
 
 #define SCFW_IMPORT_SYMBOL_VALUE_IMPL(Id, Name, Type, Flags)                  \
-    SCFW_IMPORT_SYMBOL(Id, Name, Type, Flags);                                \
+    SCFW_IMPORT_SYMBOL(Id, Name, Type, Flags, false);                         \
     SCFW_VALUE_IMPL(Id, Name, Type)
 
 //
@@ -431,13 +722,19 @@ extern "C" void __fastcall entry(void* argument1, void* argument2);
 //   - STRING_SYMBOL   -> manual PE parsing with strcmp.
 //   - DYNAMIC_RESOLVE -> `GetProcAddress` (via base class `lookup_symbol_`).
 //
+// With `SCFW_ENABLE_PINNED_RVAS`, the first two are skipped when the
+// symbol has a pinned RVA in the build the module matched. With
+// `SCFW_FLAG_SCAVENGE_IAT`, they are preceded by a look into the import
+// table of the IAT source image.
+//
 // Flags can come from the symbol itself (`entry_flags`) or be inherited
 // from the parent module (looked up via `lookup_flags_v`).
 //
 
-#define SCFW_IMPORT_SYMBOL(Id, Name, Type, Flags)                             \
+#define SCFW_IMPORT_SYMBOL(Id, Name, Type, Flags, Compact)                    \
     namespace sc {                                                            \
     namespace detail {                                                        \
+    SCFW__PACK_BEGIN                                                          \
     template<>                                                                \
     struct dispatch_table_impl<Id + 1, SCFW_MODE>                             \
         : dispatch_table_impl<Id, SCFW_MODE>                                  \
@@ -448,46 +745,100 @@ extern "C" void __fastcall entry(void* argument1, void* argument2);
             #Name ": DYNAMIC_UNLOAD can only be used with IMPORT_MODULE");    \
         static_assert(!((Flags) & SCFW_FLAG_STRING_MODULE),                   \
             #Name ": STRING_MODULE can only be used with IMPORT_MODULE");     \
+        static_assert(!((Flags) & SCFW_FLAG_DEREFERENCE) ||                   \
+                      is_dereferenceable_v<Type>,                             \
+            #Name ": DEREFERENCE requires a value import of a pointer to "    \
+            "a trivially copyable object type");                              \
                                                                               \
         friend struct callable_##Name;                                        \
         friend struct value_##Name;                                           \
                                                                               \
+        static constexpr size_t entry_id = Id + 1;                            \
         static constexpr entry_kind entry_type = entry_kind::symbol;          \
         static constexpr uint32_t entry_flags = Flags;                        \
+        static constexpr uint32_t symbol_hash = fnv1a_hash(#Name);            \
+        static constexpr bool compact_slot = Compact;                         \
+                                                                              \
+        using slot_type = std::conditional_t<                                 \
+            ((Flags) & SCFW_FLAG_DEREFERENCE) != 0,                           \
+            dereferenced_slot<Type>,                                          \
+            import_slot<Type, compact_slot>>;                                 \
                                                                               \
         __forceinline                                                         \
-        int init(void* argument1, void* argument2) {                          \
-            auto err = dispatch_table_impl<Id, SCFW_MODE>::init(argument1,    \
+        int init(init_context<SCFW_MODE>& context,                            \
+                 void* argument1, void* argument2) {                          \
+            auto err = dispatch_table_impl<Id, SCFW_MODE>::init(context,      \
+                                                                argument1,    \
                                                                 argument2);   \
             if (err) return err;                                              \
                                                                               \
+            Type Symbol{};                                                    \
+                                                                              \
             constexpr bool dynamic_resolve =                                  \
                 (entry_flags & SCFW_FLAG_DYNAMIC_RESOLVE) ||                  \
                 (lookup_flags_v<Id, SCFW_MODE, entry_kind::module> &          \
                     SCFW_FLAG_DYNAMIC_RESOLVE);                               \
                                                                               \
+            constexpr bool scavenge_iat =                                     \
+                (entry_flags & SCFW_FLAG_SCAVENGE_IAT) ||                     \
+                (lookup_flags_v<Id, SCFW_MODE, entry_kind::module> &          \
+                    SCFW_FLAG_SCAVENGE_IAT);                                  \
+                                                                              \
+            static_assert(!scavenge_iat || scavenge_iat_enabled,              \
+                #Name ": SCAVENGE_IAT requires SCFW_ENABLE_SCAVENGE_IAT");    \
+            static_assert(!scavenge_iat || !dynamic_resolve,                  \
+                #Name ": SCAVENGE_IAT and DYNAMIC_RESOLVE are exclusive");    \
+                                                                              \
             if constexpr (dynamic_resolve) {                                  \
                 /* string_symbol is implied */                                \
-                slot_##Name##_ =                                              \
-                    lookup_symbol<Type>(current_module(), _T(#Name));         \
+                Symbol = lookup_symbol<Type>(context.module, _T(#Name));      \
             } else {                                                          \
+                constexpr uint32_t pinned_hash =                              \
+                    lookup_module_hash_v<Id, SCFW_MODE>;                      \
+                                                                              \
+                if constexpr (pinned_symbol_known<pinned_hash,                \
+                                                  fnv1a_hash(#Name)>()) {     \
+                    uint32_t Rva = pinned_rva<pinned_hash, fnv1a_hash(#Name)>(\
+                        context.pinned_build);                                \
+                    if (Rva) {                                                \
+                        Symbol = reinterpret_cast<Type>(                      \
+                            static_cast<uint8_t*>(context.module) + Rva);     \
+                        return set_slot(context, Symbol);                     \
+                    }                                                         \
+                }                                                             \
+                                                                              \
                 constexpr bool string_symbol =                                \
                     (entry_flags & SCFW_FLAG_STRING_SYMBOL) ||                \
                     (lookup_flags_v<Id, SCFW_MODE, entry_kind::module> &      \
                         SCFW_FLAG_STRING_SYMBOL);                             \
                                                                               \
+                if constexpr (scavenge_iat) {                                 \
+                    if constexpr (string_symbol) {                            \
+                        Symbol = mode::scavenge_symbol<Type>(                 \
+                            iat_source(context),                              \
+                            lookup_module_hash_v<Id, SCFW_MODE>,              \
+                            _T(#Name));                                       \
+                    } else {                                                  \
+                        Symbol = mode::scavenge_symbol<Type>(                 \
+                            iat_source(context),                              \
+                            lookup_module_hash_v<Id, SCFW_MODE>,              \
+                            fnv1a_hash(#Name));                               \
+                    }                                                         \
+                    if (Symbol) return set_slot(context, Symbol);             \
+                }                                                             \
+                                                                              \
                 if constexpr (string_symbol) {                                \
-                    slot_##Name##_ =                                          \
-                        mode::lookup_symbol<Type>(current_module(),           \
+                    Symbol =                                                  \
+                        mode::lookup_symbol<Type>(context.module,             \
                                                   _T(#Name));                 \
                 } else {                                                      \
-                    slot_##Name##_ =                                          \
-                        mode::lookup_symbol<Type>(current_module(),           \
+                    Symbol =                                                  \
+                        mode::lookup_symbol<Type>(context.module,             \
                                                   fnv1a_hash(#Name));         \
                 }                                                             \
             }                                                                 \
                                                                               \
-            return slot_##Name##_ ? 0 : Id + 1;                               \
+            return set_slot(context, Symbol);                                 \
         }                                                                     \
                                                                               \
         __forceinline                                                         \
@@ -497,8 +848,20 @@ extern "C" void __fastcall entry(void* argument1, void* argument2);
         }                                                                     \
                                                                               \
     private:                                                                  \
-        Type slot_##Name##_{};                                                \
+        __forceinline                                                         \
+        int set_slot(const init_context<SCFW_MODE>& context,                  \
+                     Type symbol) {                                           \
+            return slot_##Name##_.set(symbol, context.module) ? 0 : Id + 1;   \
+        }                                                                     \
+                                                                              \
+        __forceinline                                                         \
+        Type slot() const {                                                   \
+            return slot_##Name##_.get(current_module());                      \
+        }                                                                     \
+                                                                              \
+        slot_type slot_##Name##_{};                                           \
     };                                                                        \
+    SCFW__PACK_END                                                            \
     } /* namespace detail */                                                  \
     } /* namespace sc */
 
@@ -510,7 +873,7 @@ extern "C" void __fastcall entry(void* argument1, void* argument2);
 //
 //   struct callable_Sleep : proxy_callable<decltype(&::Sleep), callable_Sleep> {
 //       decltype(&::Sleep) get() const {
-//           return ((dispatch_table_impl<N>*) _(&__dispatch_table))->slot_Sleep_;
+//           return ((dispatch_table_impl<N>*) _(&__dispatch_table))->slot();
 //       }
 //   };
 //   inline callable_Sleep Sleep{};   // in namespace sc
@@ -528,7 +891,7 @@ extern "C" void __fastcall entry(void* argument1, void* argument2);
         __forceinline                                                         \
         decltype(&::Name) get() const {                                       \
             return reinterpret_cast<dispatch_table_impl<Id + 1, SCFW_MODE>*>(\
-                _(&__dispatch_table))->slot_##Name##_;                        \
+                _(&__dispatch_table))->slot();                                \
         }                                                                     \
     };                                                                        \
     } /* namespace detail */                                                  \
@@ -540,24 +903,28 @@ extern "C" void __fastcall entry(void* argument1, void* argument2);
 // read/write access to the slot via operator overloads (`operator T&`,
 // `operator=`, `operator&`, `operator bool`).
 //
-// Used for non-callable exports (data pointers, etc.).
+// Used for non-callable exports (data pointers, etc.). With
+// `SCFW_FLAG_DEREFERENCE`, the slot holds the variable's value rather
+// than its address, and so does the proxy.
 //
 
 #define SCFW_VALUE_IMPL(Id, Name, Type)                                       \
     namespace sc {                                                            \
     namespace detail {                                                        \
     struct value_##Name                                                       \
-        : proxy_value<Type, value_##Name>                                     \
+        : proxy_value<slot_value_t<Id + 1, SCFW_MODE>, value_##Name>          \
     {                                                                         \
-        friend struct proxy_value<Type, value_##Name>;                        \
+        friend struct proxy_value<slot_value_t<Id + 1, SCFW_MODE>,            \
+                                  value_##Name>;                              \
                                                                               \
-        using proxy_value<Type, value_##Name>::operator=;                     \
+        using proxy_value<slot_value_t<Id + 1, SCFW_MODE>,                    \
+                          value_##Name>::operator=;                           \
                                                                               \
     private:                                                                  \
         __forceinline                                                         \
-        Type* get() const {                                                   \
+        slot_value_t<Id + 1, SCFW_MODE>* get() const {                        \
             return &reinterpret_cast<dispatch_table_impl<Id + 1, SCFW_MODE>*>(\
-                _(&__dispatch_table))->slot_##Name##_;                        \
+                _(&__dispatch_table))->slot_##Name##_.value;                  \
         }                                                                     \
     };                                                                        \
     } /* namespace detail */                                                  \
@@ -636,6 +1003,171 @@ enum class entry_kind {
     symbol
 };
 
+//
+// Storage of a resolved `IMPORT_SYMBOL`: the pointer itself or, with
+// `SCFW_ENABLE_COMPACT_SLOTS` (callable imports on x64), its offset from
+// the module base. `set()` fails for `nullptr` and for offsets that do
+// not fit.
+//
+
+template <typename T, bool Compact>
+struct import_slot {
+    using value_type = T;
+
+    __forceinline
+    bool set(T symbol, void* module) {
+        (void)module;
+        value = symbol;
+        return symbol != nullptr;
+    }
+
+    __forceinline
+    T get(void* module) const {
+        (void)module;
+        return value;
+    }
+
+    T value;
+};
+
+template <typename T>
+struct import_slot<T, true> {
+    __forceinline
+    bool set(T symbol, void* module) {
+        intptr_t Delta = reinterpret_cast<intptr_t>(symbol) - reinterpret_cast<intptr_t>(module);
+        value = static_cast<int32_t>(Delta);
+        return symbol != nullptr && Delta == value;
+    }
+
+    __forceinline
+    T get(void* module) const {
+        return reinterpret_cast<T>(static_cast<uint8_t*>(module) + value);
+    }
+
+    int32_t value;
+};
+
+#ifdef SCFW_ENABLE_DETACH
+//
+// How `_detach` (`detach.S`) lets the detached thread run: its last
+// instruction is a tail-jump to `routine(handle, NULL)`, which returns
+// straight to the shellcode's caller. `NtResumeThread` on the suspended
+// thread in user mode, `ZwSetEvent` on the event the thread waits for in
+// kernel mode. The assembly code reads both at fixed offsets.
+//
+
+struct detach_release {
+    void* routine;
+    void* handle;
+};
+#endif
+
+//
+// Whether an `IMPORT_MODULE` keeps its handle in the dispatch table after
+// `init()`. Always, unless `SCFW_ENABLE_INIT_CONTEXT`; then only if
+// `destroy()` unloads it, or compact slots are relative to it.
+//
+
+constexpr bool module_persistent(uint32_t flags) {
+#if defined(SCFW_ENABLE_INIT_CONTEXT)
+    return ((flags & SCFW_FLAG_DYNAMIC_LOAD) && (flags & SCFW_FLAG_DYNAMIC_UNLOAD))
+        || SCFW__COMPACT_SLOTS;
+#else
+    (void)flags;
+    return true;
+#endif
+}
+
+//
+// Module handle storage, inserted between an `IMPORT_MODULE` entry and
+// its predecessor. The non-persistent variant adds no bytes.
+//
+
+SCFW__PACK_BEGIN
+template <typename Base, bool Persistent>
+struct module_holder : Base {
+protected:
+    __forceinline
+    void* current_module() const {
+        return module_;
+    }
+
+    __forceinline
+    void hold_module(void* module) {
+        module_ = module;
+    }
+
+private:
+    void* module_{};
+};
+SCFW__PACK_END
+
+template <typename Base>
+struct module_holder<Base, false> : Base {
+protected:
+    __forceinline
+    void* current_module() const {
+        return nullptr;
+    }
+
+    __forceinline
+    void hold_module(void* module) {
+        (void)module;
+    }
+};
+
+//
+// Whether `T` can be imported with `SCFW_FLAG_DEREFERENCE`: a pointer to
+// a trivially copyable object, so the variable it points to can be copied
+// into the table.
+//
+
+template <typename T>
+inline constexpr bool is_dereferenceable_v =
+    std::is_pointer_v<T> &&
+    std::is_object_v<std::remove_pointer_t<T>> &&
+    std::is_trivially_copyable_v<std::remove_cv_t<std::remove_pointer_t<T>>>;
+
+//
+// Storage of an `SCFW_FLAG_DEREFERENCE` import: a copy of the variable
+// `T` points to, taken by `set()`, which fails for a missing export.
+// `get()` is the copy's address (only used by callable proxies, which
+// cannot be dereferenced).
+//
+
+template <typename T>
+struct dereferenced_slot {
+    using value_type = std::remove_cv_t<std::remove_pointer_t<T>>;
+
+    __forceinline
+    bool set(T symbol, void* module) {
+        (void)module;
+        if (!symbol) {
+            return false;
+        }
+        value = *symbol;
+        return true;
+    }
+
+    __forceinline
+    value_type* get(void* module) const {
+        (void)module;
+        return const_cast<value_type*>(&value);
+    }
+
+    value_type value;
+};
+
+//
+// Checked by `IMPORT_SYMBOL` entries with `SCFW_FLAG_SCAVENGE_IAT`.
+//
+
+#ifdef SCFW_ENABLE_SCAVENGE_IAT
+inline constexpr bool scavenge_iat_enabled = true;
+#else
+inline constexpr bool scavenge_iat_enabled = false;
+#endif
+
 //
 // Primary template for platform-specific type bindings. Specialized by
 // `usermode.h` / `kernelmode.h` to map abstract operations (`load_module`,
@@ -658,6 +1190,33 @@ struct mode_traits {
 #ifdef SCFW_ENABLE_LOOKUP_SYMBOL
     using lookup_symbol_fn = void;
 #endif
+#ifdef SCFW_ENABLE_MAPPED_FILE
+    using mapped_file_api = void;
+#endif
+#ifdef SCFW_ENABLE_ASYNC_IO
+    using async_io_api = void;
+#endif
+#ifdef SCFW_ENABLE_PARALLEL_FOR
+    using parallel_for_api = void;
+#endif
+#ifdef SCFW_ENABLE_WAIT_ON_ADDRESS
+    using wait_on_address_api = void;
+#endif
+#ifdef SCFW_ENABLE_DETACH
+    using detach_api = void;
+#endif
+#ifdef SCFW_ENABLE_FOR_EACH_CPU
+    using for_each_cpu_api = void;
+#endif
+#ifdef SCFW_ENABLE_USER_MAPPING
+    using user_mapping_api = void;
+#endif
+#ifdef SCFW_ENABLE_SYSTEM_SNAPSHOT
+    using system_snapshot_api = void;
+#endif
+#ifdef SCFW_ENABLE_INIT_CONTEXT
+    using init_state = void;
+#endif
 
     //
     // Manual PE export table lookup. Overloaded for string name and
@@ -669,6 +1228,47 @@ struct mode_traits {
 
     template <typename F>
     static F lookup_symbol(void* module, uint32_t hash);
+
+    //
+    // Build check for the pinned RVA database (`runtime/pinned.h`).
+    //
+
+    static bool image_matches(void* module, uint32_t time_date_stamp, uint32_t size_of_image);
+
+    //
+    // IAT scavenging: the bound import of `name`/`hash` from the module
+    // `module_hash` in the import table of `source`, or `nullptr`.
+    // Implemented in `common.h`.
+    //
+
+    template <typename F>
+    static F scavenge_symbol(void* source, uint32_t module_hash, const char* name);
+
+    template <typename F>
+    static F scavenge_symbol(void* source, uint32_t module_hash, uint32_t hash);
+};
+
+//
+// State that is only needed while `init()` runs, on `_entry`'s stack:
+// the module the following `IMPORT_SYMBOL`s are resolved from (set by
+// each `IMPORT_MODULE`), and which of its pinned builds it is (0: none).
+//
+// With `SCFW_ENABLE_INIT_CONTEXT`, also what the base init sets up for
+// the entries alone: the `SCFW_FLAG_SCAVENGE_IAT` source image and the
+// backend's `mode_traits<Mode>::init_state` (the kernel-mode module
+// snapshot). Otherwise these are kept in the dispatch table.
+//
+
+template <typename Mode>
+struct init_context {
+    void* module;
+    uint32_t pinned_build;
+#ifdef SCFW_ENABLE_INIT_CONTEXT
+#   ifdef SCFW_ENABLE_SCAVENGE_IAT
+    void* iat_source;
+#   endif
+    typename mode_traits<Mode>::init_state mode_state;
+#endif
 };
 
 //
@@ -698,6 +1298,56 @@ struct dispatch_table_fields {
 #ifdef SCFW_ENABLE_LOOKUP_SYMBOL
     typename mode::lookup_symbol_fn lookup_symbol_;
 #endif
+
+    //
+    // Thread creation API and the `_entry` arguments, handed over to the
+    // detached thread (see `IMPORT_END()`), and how to let it run.
+    //
+
+#ifdef SCFW_ENABLE_DETACH
+    typename mode::detach_api detach_;
+    void* detach_argument1_;
+    void* detach_argument2_;
+    detach_release detach_release_;
+#endif
+
+    //
+    // Function pointers used by the optional framework helpers
+    // (`platform/windows/usermode/*.h`, ...). Resolved by the platform
+    // `init()` and never touched by the assembly startup code.
+    //
+
+#ifdef SCFW_ENABLE_MAPPED_FILE
+    typename mode::mapped_file_api mapped_file_;
+#endif
+#ifdef SCFW_ENABLE_ASYNC_IO
+    typename mode::async_io_api async_io_;
+#endif
+#ifdef SCFW_ENABLE_PARALLEL_FOR
+    typename mode::parallel_for_api parallel_for_;
+#endif
+#ifdef SCFW_ENABLE_WAIT_ON_ADDRESS
+    typename mode::wait_on_address_api wait_on_address_;
+#endif
+#ifdef SCFW_ENABLE_FOR_EACH_CPU
+    typename mode::for_each_cpu_api for_each_cpu_;
+#endif
+#ifdef SCFW_ENABLE_USER_MAPPING
+    typename mode::user_mapping_api user_mapping_;
+#endif
+#ifdef SCFW_ENABLE_SYSTEM_SNAPSHOT
+    typename mode::system_snapshot_api system_snapshot_;
+#endif
+
+    //
+    // Image whose import table `SCFW_FLAG_SCAVENGE_IAT` entries are read
+    // from. Located by the platform `init()`; in the init context instead
+    // with `SCFW_ENABLE_INIT_CONTEXT`.
+    //
+
+#if defined(SCFW_ENABLE_SCAVENGE_IAT) && !defined(SCFW_ENABLE_INIT_CONTEXT)
+    void* iat_source_;
+#endif
 };
 
 //
@@ -731,6 +1381,14 @@ struct dispatch_table_storage<Mode, true>
 
 struct dispatch_table;
 
+//
+// The dispatch table instance. Defined by `IMPORT_END()`; declared here as
+// well so that framework helpers can reach the base-level fields before the
+// final type is known.
+//
+
+extern "C" dispatch_table __dispatch_table;
+
 //
 // Dispatch table template. Each `IMPORT_MODULE` / `IMPORT_SYMBOL` specializes
 // `dispatch_table_impl<N+1>` inheriting from `<N>`. The base case `<0>` is
@@ -748,11 +1406,29 @@ struct dispatch_table_impl<0, Mode>
     using mode = mode_traits<Mode>;
 
     //
-    // Initialize base-level function pointers. Implemented in the platform
-    // backend (e.g., `usermode.h` resolves `VirtualFree`, `LoadLibraryA`, etc.).
+    // Entries number themselves from 1 (`init()` error codes); see
+    // `IMPORT_MODULE` / `IMPORT_SYMBOL`.
+    //
+
+    static constexpr size_t entry_id = 0;
+
+    //
+    // Initialize base-level function pointers; start of the entries'
+    // `init()` chain. Implemented in the platform backend (e.g.,
+    // `usermode.h` resolves `VirtualFree`, `LoadLibraryA`, etc.).
+    //
+
+    int init(init_context<Mode>& context, void* argument1, void* argument2);
+
+    //
+    // Called by `_entry` right after `init()`, whether it succeeded or
+    // not. Releases what is only needed while the entries are resolved
+    // (the kernel-mode module snapshot).
     //
 
-    int init(void* argument1, void* argument2);
+    void finish_init(init_context<Mode>& context) {
+        (void)context;
+    }
 
     //
     // Base-level teardown. Usually empty (cleanup is handled by asm).
@@ -760,14 +1436,86 @@ struct dispatch_table_impl<0, Mode>
 
     void destroy(void* argument1, void* argument2);
 
+#ifdef SCFW_ENABLE_DETACH
+    //
+    // Stores the arguments and starts the thread that runs `entry()`,
+    // held back until `detach_release_` is invoked. Returns non-zero if
+    // the thread could not be created. Implemented in the platform
+    // backend.
+    //
+
+    int detach(void* argument1, void* argument2);
+
+    //
+    // First thing the detached thread does: waits for the release if it
+    // has to, and closes the handle it was released through.
+    //
+
+    void enter_detached();
+#endif
+
+    //
+    // Read-only access to the base-level function pointers. Used by the
+    // framework helpers, which call through the pointers resolved during
+    // `init()` instead of declaring their own imports.
+    //
+
+    __forceinline
+    const dispatch_table_fields<Mode>& fields() const {
+        return *this;
+    }
+
+    //
+    // The backend's own state (`mode_traits<Mode>` instance). Only exists
+    // for backends that have any; kernelmode keeps `kernel_base` and the
+    // module snapshot (or, with `SCFW_ENABLE_INIT_CONTEXT`, a pointer to
+    // it) there.
+    //
+
+    __forceinline
+    const mode_traits<Mode>& mode_state() const {
+        return this->mode_;
+    }
+
 protected:
     //
     // Returns `nullptr` at the base level. Overridden by `IMPORT_MODULE`
-    // entries which store their resolved module handle.
+    // entries (`module_holder`); valid after `init()` only for modules that
+    // keep their handle.
     //
 
     void* current_module() const;
 
+    //
+    // Image searched by `SCFW_FLAG_SCAVENGE_IAT` entries; `nullptr` if
+    // it was not found (or scavenging is not enabled).
+    //
+
+    __forceinline
+    void* iat_source(const init_context<Mode>& context) const {
+#if defined(SCFW_ENABLE_SCAVENGE_IAT) && defined(SCFW_ENABLE_INIT_CONTEXT)
+        return context.iat_source;
+#elif defined(SCFW_ENABLE_SCAVENGE_IAT)
+        (void)context;
+        return this->iat_source_;
+#else
+        (void)context;
+        return nullptr;
+#endif
+    }
+
+#ifdef SCFW_ENABLE_SCAVENGE_IAT
+    __forceinline
+    void set_iat_source(init_context<Mode>& context, void* source) {
+#   ifdef SCFW_ENABLE_INIT_CONTEXT
+        context.iat_source = source;
+#   else
+        (void)context;
+        this->iat_source_ = source;
+#   endif
+    }
+#endif
+
     //
     // Module/symbol resolution helpers. The platform backend provides
     // the actual implementations. `IMPORT_MODULE`/`IMPORT_SYMBOL` `init()`
@@ -783,6 +1531,18 @@ protected:
     F lookup_symbol(void* module, const char* name) const;
 };
 
+//
+// Returns the PIC-adjusted base of the dispatch table. Every entry inherits
+// from `dispatch_table_impl<0, Mode>` at offset 0, so the cast is valid
+// even while `dispatch_table` is still incomplete.
+//
+
+template <typename Mode>
+__forceinline
+dispatch_table_impl<0, Mode>* base_table() {
+    return reinterpret_cast<dispatch_table_impl<0, Mode>*>(_(&__dispatch_table));
+}
+
 //
 // Walks the dispatch table inheritance chain backwards from entry `Id`
 // to find the flags of the nearest entry of a given kind.
@@ -816,6 +1576,90 @@ struct lookup_flags {
 template <size_t Id, typename Mode, entry_kind EntryKind>
 constexpr uint32_t lookup_flags_v = lookup_flags<Id, Mode, EntryKind>::value;
 
+//
+// Same walk for the FNV-1a hash of the nearest module's name. Keys the
+// pinned RVA database (`runtime/pinned.h`); 0 if there is no module.
+//
+
+template <size_t Id, typename Mode>
+struct lookup_module_hash {
+    static constexpr uint32_t get() {
+        if constexpr (Id == 0) {
+            return 0;
+        } else if constexpr (dispatch_table_impl<Id, Mode>::entry_type != entry_kind::module) {
+            return lookup_module_hash<Id - 1, Mode>::get();
+        } else {
+            return dispatch_table_impl<Id, Mode>::module_hash;
+        }
+    }
+
+    static constexpr uint32_t value = get();
+};
+
+template <size_t Id, typename Mode>
+constexpr uint32_t lookup_module_hash_v = lookup_module_hash<Id, Mode>::value;
+
+//
+// What the value proxy of entry `Id` refers to: the import itself, or the
+// copy of the variable with `SCFW_FLAG_DEREFERENCE`.
+//
+
+template <size_t Id, typename Mode>
+using slot_value_t = typename dispatch_table_impl<Id, Mode>::slot_type::value_type;
+
+#ifdef SCFW_ENABLE_RESULT
+//
+// FNV-1a hash of the name of entry `Id` (module or symbol); 0 for the base.
+//
+
+template <size_t Id, typename Mode>
+constexpr uint32_t entry_name_hash() {
+    if constexpr (Id == 0) {
+        return 0;
+    } else {
+        using entry = dispatch_table_impl<Id, Mode>;
+
+        if constexpr (entry::entry_type == entry_kind::module) {
+            return entry::module_hash;
+        } else {
+            return entry::symbol_hash;
+        }
+    }
+}
+
+//
+// The hashes of entries `0..N`, indexed by `entry_id`. Emitted once as
+// constant data (merged into `.text`).
+//
+
+template <typename Mode, typename Ids>
+struct import_hash_table;
+
+template <typename Mode, size_t... Id>
+struct import_hash_table<Mode, std::index_sequence<Id...>> {
+    static constexpr uint32_t value[] = { entry_name_hash<Id, Mode>()... };
+};
+
+//
+// FNV-1a hash of the name of the entry whose `init()` failed with `err`
+// (an entry fails with its own `entry_id`), for a table of `N` entries.
+// 0 if the base `init()` failed. Only reached on failure, so this is a
+// single load rather than a comparison per entry inlined into `_entry`.
+//
+
+template <size_t N, typename Mode>
+__forceinline
+uint32_t import_hash(int err) {
+    using table = import_hash_table<Mode, std::make_index_sequence<N + 1>>;
+
+    if (static_cast<size_t>(err) > N) {
+        return 0;
+    }
+
+    return _(table::value)[err];
+}
+#endif
+
 //
 // CRTP base for callable proxies. Makes a zero-size struct behave like a
 // function pointer. The Derived class must provide `get()` returning the
@@ -825,6 +1669,26 @@ constexpr uint32_t lookup_flags_v = lookup_flags<Id, Mode, EntryKind>::value;
 //                  =>  callable_Sleep::get()(1000)
 //                  =>  __dispatch_table.slot_Sleep_(1000)
 //
+// With `SCFW_ENABLE_IMPORT_THUNKS` on x86, `operator()` calls `thunk()`
+// instead: one out-of-line function per import with the import's own
+// signature, which locates the slot (`_pc()` and the delta arithmetic)
+// and tail-jumps through it. A call site is then a plain `call rel32`
+// instead of repeating the 10-15 bytes of address computation:
+//
+//   thunk_Sleep:                     call site:
+//     call  __pc                       push  1000
+//     sub   eax, offset __pc           call  thunk_Sleep
+//     add   eax, offset __dispatch_table
+//     jmp   dword ptr [eax + slot]
+//
+// `eax` is free at the thunk's entry in every x86 calling convention.
+// `musttail` guarantees the jump; the arguments stay where the caller put
+// them. Variadic imports are always called inline.
+//
+
+#if defined(SCFW_ENABLE_IMPORT_THUNKS) && defined(_M_IX86)
+#   define SCFW__IMPORT_THUNKS
+#endif
 
 template <typename F, typename Derived>
 struct proxy_callable;
@@ -833,8 +1697,20 @@ template <typename R, typename... Args, typename Derived>
 struct proxy_callable<R(*)(Args...), Derived> {
     __forceinline
     R operator()(Args... args) const {
+#ifdef SCFW__IMPORT_THUNKS
+        return thunk(args...);
+#else
         return static_cast<const Derived*>(this)->get()(args...);
+#endif
     }
+
+#ifdef SCFW__IMPORT_THUNKS
+private:
+    __declspec(noinline)
+    static R thunk(Args... args) {
+        [[clang::musttail]] return Derived{}.get()(args...);
+    }
+#endif
 };
 
 //
@@ -863,16 +1739,40 @@ template <typename R, typename... Args, typename Derived>
 struct proxy_callable<R(__stdcall*)(Args...), Derived> {
     __forceinline
     R __stdcall operator()(Args... args) const {
+#ifdef SCFW__IMPORT_THUNKS
+        return thunk(args...);
+#else
         return static_cast<const Derived*>(this)->get()(args...);
+#endif
     }
+
+#ifdef SCFW__IMPORT_THUNKS
+private:
+    __declspec(noinline)
+    static R __stdcall thunk(Args... args) {
+        [[clang::musttail]] return Derived{}.get()(args...);
+    }
+#endif
 };
 
 template <typename R, typename... Args, typename Derived>
 struct proxy_callable<R(__fastcall*)(Args...), Derived> {
     __forceinline
     R __fastcall operator()(Args... args) const {
+#ifdef SCFW__IMPORT_THUNKS
+        return thunk(args...);
+#else
         return static_cast<const Derived*>(this)->get()(args...);
+#endif
     }
+
+#ifdef SCFW__IMPORT_THUNKS
+private:
+    __declspec(noinline)
+    static R __fastcall thunk(Args... args) {
+        [[clang::musttail]] return Derived{}.get()(args...);
+    }
+#endif
 };
 #endif
 
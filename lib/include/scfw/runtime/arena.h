@@ -0,0 +1,134 @@
+#pragma once
+
+//
+// Bump allocator over caller-provided memory.
+//
+// Shellcode has no heap of its own, and importing `HeapAlloc` or
+// `ExAllocatePoolWithTag` for every small table is wasteful. An arena hands
+// out pieces of one buffer (a stack array, a pool allocation, a mapped
+// region, ...) by bumping an offset. Nothing is freed individually;
+// `rewind()` or `reset()` release everything allocated after a point.
+//
+//   uint8_t storage[4096];
+//   sc::arena arena{ storage, sizeof(storage) };
+//
+//   auto table = arena.allocate<request>(32);     // nullptr when exhausted
+//   auto mark = arena.mark();
+//   ...                                            // scratch allocations
+//   arena.rewind(mark);
+//
+// The arena stores no absolute addresses of its own, only what the caller
+// hands it, so it is position-independent on x86 as well.
+//
+
+#include <cstdint>
+#include <cstddef>
+
+namespace sc {
+
+class arena {
+public:
+    static constexpr size_t default_alignment = sizeof(void*) * 2;
+
+    arena() = default;
+
+    __forceinline
+    arena(void* base, size_t size)
+        : base_(static_cast<uint8_t*>(base))
+        , size_(size)
+    {}
+
+    //
+    // Returns `size` bytes aligned to `alignment` (a power of two), or
+    // `nullptr` if the arena is exhausted. The memory is not zeroed.
+    //
+
+    __forceinline
+    void* allocate(size_t size, size_t alignment = default_alignment) {
+        uintptr_t address = reinterpret_cast<uintptr_t>(base_) + offset_;
+        size_t padding = static_cast<size_t>(-address & (alignment - 1));
+
+        if (padding > size_ - offset_ || size > size_ - offset_ - padding) {
+            return nullptr;
+        }
+
+        last_ = offset_ + padding;
+        offset_ = last_ + size;
+        return base_ + last_;
+    }
+
+    template <typename T>
+    __forceinline
+    T* allocate(size_t count = 1) {
+        if (count > SIZE_MAX / sizeof(T)) {
+            return nullptr;
+        }
+
+        return static_cast<T*>(allocate(count * sizeof(T), alignof(T)));
+    }
+
+    //
+    // Grows (or shrinks) the most recent allocation in place. Fails if
+    // `pointer` is not the most recent allocation or the arena cannot fit
+    // `size` bytes. Used for buffers that grow geometrically, so that
+    // retrying does not strand the previous attempt.
+    //
+
+    __forceinline
+    bool resize(void* pointer, size_t size) {
+        if (pointer != base_ + last_ || static_cast<uint8_t*>(pointer) == base_ + offset_) {
+            return false;
+        }
+
+        if (size > size_ - last_) {
+            return false;
+        }
+
+        offset_ = last_ + size;
+        return true;
+    }
+
+    //
+    // Saves / restores the allocation offset. Everything allocated after
+    // `mark()` is released by `rewind()`.
+    //
+
+    __forceinline
+    size_t mark() const {
+        return offset_;
+    }
+
+    __forceinline
+    void rewind(size_t mark) {
+        offset_ = mark;
+        last_ = mark;
+    }
+
+    __forceinline
+    void reset() {
+        rewind(0);
+    }
+
+    __forceinline
+    size_t used() const {
+        return offset_;
+    }
+
+    __forceinline
+    size_t capacity() const {
+        return size_;
+    }
+
+private:
+    uint8_t* base_{};
+    size_t size_{};
+    size_t offset_{};
+
+    //
+    // Start of the most recent allocation, for `resize()`.
+    //
+
+    size_t last_{};
+};
+
+} // namespace sc
@@ -0,0 +1,108 @@
+#pragma once
+
+//
+// Completion signal for hosts that watch the guest from outside.
+//
+// A VMI host that runs a payload in a guest otherwise has to poll guest
+// memory (or single-step) to find out when it has finished. With
+// `SCFW_ENABLE_COMPLETION_SIGNAL`, `_entry` ends with an instruction that
+// traps to the host, so the host sees completion as a single VM exit.
+//
+// At the trapping instruction:
+//
+//   RAX/EAX  `SCFW_COMPLETION_MAGIC`
+//   RCX/ECX  status: `entry()`'s status with `SCFW_ENABLE_RESULT`,
+//            otherwise 0 once `entry()` has returned. If `init()` failed:
+//            `SCFW_RESULT_INIT_FAILED` / the failing entry's number; if
+//            the detached thread could not be created: its NTSTATUS
+//   RDX/EDX  the caller's `sc::entry_result*` (`SCFW_ENABLE_RESULT`), or 0
+//
+// `SCFW_COMPLETION_SIGNAL` picks the instruction:
+//
+//   SCFW_COMPLETION_CPUID   `cpuid` with leaf `SCFW_COMPLETION_MAGIC`
+//                           (default). Always exits under VT-x, and
+//                           harmless without a hypervisor: the default
+//                           leaf is in the hypervisor range
+//                           (0x40000000-0x4FFFFFFF).
+//   SCFW_COMPLETION_VMCALL  `vmcall` (Intel). Raises #UD when no
+//                           hypervisor handles it.
+//   SCFW_COMPLETION_INT3    `int3`, for hosts that intercept #BP. Without
+//                           one, it is an unhandled breakpoint (a crash in
+//                           user mode, a bugcheck in kernel mode).
+//   SCFW_COMPLETION_WRITE   Stores the status to `SCFW_COMPLETION_ADDRESS`,
+//                           a guest address the host write-protects (e.g.
+//                           in the EPT). Must be writable in the guest.
+//
+// The signal is raised after `destroy()` but before `_start` frees the
+// shellcode, i.e. the shellcode may still be executing (and its memory
+// allocated) at that point. In detached mode it is raised by the thread
+// that ran `entry()`, or by `_entry` if `init()` or creating the thread
+// failed.
+//
+
+#include <cstdint>
+
+#ifdef SCFW_ENABLE_COMPLETION_SIGNAL
+
+#define SCFW_COMPLETION_CPUID  1
+#define SCFW_COMPLETION_VMCALL 2
+#define SCFW_COMPLETION_INT3   3
+#define SCFW_COMPLETION_WRITE  4
+
+#ifndef SCFW_COMPLETION_SIGNAL
+#   define SCFW_COMPLETION_SIGNAL SCFW_COMPLETION_CPUID
+#endif
+
+#ifndef SCFW_COMPLETION_MAGIC
+#   define SCFW_COMPLETION_MAGIC 0x4F534346
+#endif
+
+#if SCFW_COMPLETION_SIGNAL == SCFW_COMPLETION_WRITE && !defined(SCFW_COMPLETION_ADDRESS)
+#   error "SCFW_COMPLETION_WRITE requires SCFW_COMPLETION_ADDRESS"
+#endif
+
+namespace sc {
+namespace detail {
+
+__forceinline
+void signal_completion(uintptr_t status, void* result) {
+    uintptr_t Magic = SCFW_COMPLETION_MAGIC;
+
+    //
+    // "memory": everything `entry()` wrote (and `*result`) is in memory
+    // before the host looks.
+    //
+
+#if SCFW_COMPLETION_SIGNAL == SCFW_COMPLETION_CPUID
+    __asm__ volatile("cpuid" : "+a"(Magic), "+c"(status), "+d"(result) : : "ebx", "memory");
+#elif SCFW_COMPLETION_SIGNAL == SCFW_COMPLETION_VMCALL
+    __asm__ volatile("vmcall" : "+a"(Magic), "+c"(status), "+d"(result) : : "memory");
+#elif SCFW_COMPLETION_SIGNAL == SCFW_COMPLETION_INT3
+    __asm__ volatile("int3" : "+a"(Magic), "+c"(status), "+d"(result) : : "memory");
+#elif SCFW_COMPLETION_SIGNAL == SCFW_COMPLETION_WRITE
+    auto Slot = reinterpret_cast<volatile uintptr_t*>(SCFW_COMPLETION_ADDRESS);
+    __asm__ volatile("mov {%[status], %[slot]|%[slot], %[status]}"
+                     : [slot] "=m"(*Slot), "+a"(Magic)
+                     : [status] "c"(status), "d"(result)
+                     : "memory");
+#else
+#   error "unknown SCFW_COMPLETION_SIGNAL"
+#endif
+}
+
+} // namespace detail
+} // namespace sc
+
+//
+// Spliced into `_entry` / `_entry_thread`; expands to nothing without the
+// option.
+//
+
+#define SCFW_SIGNAL_COMPLETION(Status, Result)                                \
+    ::sc::detail::signal_completion(static_cast<uintptr_t>(Status), (Result))
+
+#else
+
+#define SCFW_SIGNAL_COMPLETION(Status, Result) ((void)0)
+
+#endif
@@ -0,0 +1,421 @@
+#pragma once
+
+//
+// C++20 coroutines on an arena, driven by a single-threaded scheduler.
+//
+// A payload waiting on many events (I/O completions, timers, signals from
+// the guest) can write each wait as straight-line code and still keep all
+// of them pending on one thread:
+//
+//   sc::task watch(sc::scheduler& Scheduler, HANDLE Event) {
+//       sc::completion Done{ Scheduler };
+//       register_wait(Event, &Done);           // callback: Done.complete(Status)
+//       NTSTATUS Status = (NTSTATUS)co_await Done;
+//       ...
+//   }
+//
+//   uint8_t Storage[16 * 1024];
+//   sc::arena Arena{ Storage, sizeof(Storage) };
+//   sc::scheduler Scheduler{ Arena };
+//
+//   Scheduler.spawn(watch(Scheduler, Event1));
+//   Scheduler.spawn(watch(Scheduler, Event2));
+//   Scheduler.run([] { alertable_sleep(); });  // until every task finished
+//
+//   sc::task       - coroutine return type. Its first parameter must be the
+//                    `sc::scheduler&`: the frame is allocated from the
+//                    scheduler's arena (promise `operator new`). Frames of
+//                    finished tasks are kept on a free list and reused by
+//                    later tasks of the same or smaller size. If the arena
+//                    is exhausted, the returned task is empty.
+//   sc::scheduler  - ready list and run loop. `spawn()`, `run_ready()` and
+//                    `run()` belong to the scheduler thread; `post()` may
+//                    be called from any thread (completion callbacks, APCs,
+//                    thread pool callbacks, DPCs).
+//   sc::completion - one-shot awaitable. A callback calls `complete(value)`
+//                    from any thread; the awaiting task is queued on the
+//                    scheduler and gets `value` from `co_await`. Rearms once
+//                    the task has resumed.
+//   yield()        - `co_await Scheduler.yield()` lets the other ready
+//                    tasks run first.
+//
+// Tasks are only ever resumed by the scheduler thread, so code between two
+// `co_await`s never runs concurrently with another task. Callbacks only
+// queue, they never resume inline.
+//
+// There are no exceptions: `unhandled_exception()` is never reached with
+// `-fno-exceptions`.
+//
+// x64 only. Every coroutine frame stores the addresses of the coroutine's
+// resume and destroy functions, and on x86 those are absolute addresses
+// that `_()` has no chance to fix up.
+//
+
+#include <coroutine>
+#include <cstdint>
+#include <cstddef>
+
+#include "arena.h"
+
+#ifdef _M_IX86
+#   error "coro.h is not supported on x86: coroutine frames hold absolute code addresses"
+#endif
+
+namespace sc {
+
+class scheduler;
+
+namespace detail {
+
+//
+// Link in the scheduler's ready list. Lives in the promise or the awaiter,
+// i.e. in the coroutine frame - queuing never allocates.
+//
+
+struct coro_node {
+    coro_node* next;
+    std::coroutine_handle<> handle;
+};
+
+//
+// Precedes every frame allocated by the scheduler.
+//
+
+struct alignas(arena::default_alignment) coro_frame_header {
+    coro_frame_header* next;
+    size_t size;
+    scheduler* owner;
+};
+
+} // namespace detail
+
+class task {
+public:
+    struct promise_type {
+        struct final_awaiter {
+            __forceinline bool await_ready() const noexcept { return false; }
+            void await_suspend(std::coroutine_handle<promise_type> handle) noexcept;
+            __forceinline void await_resume() const noexcept {}
+        };
+
+        template <typename... Args>
+        static void* operator new(size_t size, scheduler& owner, Args&...) noexcept;
+        static void operator delete(void* frame, size_t size) noexcept;
+
+        __forceinline
+        static task get_return_object_on_allocation_failure() noexcept {
+            return task{};
+        }
+
+        __forceinline
+        task get_return_object() noexcept {
+            return task{ std::coroutine_handle<promise_type>::from_promise(*this) };
+        }
+
+        __forceinline std::suspend_always initial_suspend() const noexcept { return {}; }
+        __forceinline final_awaiter final_suspend() const noexcept { return {}; }
+        __forceinline void return_void() const noexcept {}
+        __forceinline void unhandled_exception() const noexcept {}
+
+        detail::coro_node node;
+        scheduler* owner;
+    };
+
+    task() = default;
+    task(const task&) = delete;
+    task& operator=(const task&) = delete;
+
+    __forceinline
+    task(task&& other) noexcept
+        : handle_(other.handle_)
+    {
+        other.handle_ = nullptr;
+    }
+
+    //
+    // A task that was never spawned is destroyed with its frame.
+    //
+
+    __forceinline
+    ~task() {
+        if (handle_) {
+            handle_.destroy();
+        }
+    }
+
+    //
+    // `false` if the frame could not be allocated.
+    //
+
+    __forceinline
+    explicit operator bool() const {
+        return static_cast<bool>(handle_);
+    }
+
+private:
+    friend class scheduler;
+
+    __forceinline
+    explicit task(std::coroutine_handle<promise_type> handle)
+        : handle_(handle)
+    {}
+
+    std::coroutine_handle<promise_type> handle_;
+};
+
+class scheduler {
+public:
+    struct yield_awaiter {
+        __forceinline bool await_ready() const noexcept { return false; }
+
+        __forceinline
+        void await_suspend(std::coroutine_handle<> handle) noexcept {
+            node.handle = handle;
+            owner->post(&node);
+        }
+
+        __forceinline void await_resume() const noexcept {}
+
+        scheduler* owner;
+        detail::coro_node node;
+    };
+
+    __forceinline
+    explicit scheduler(arena& frames)
+        : frames_(&frames)
+    {}
+
+    scheduler(const scheduler&) = delete;
+    scheduler& operator=(const scheduler&) = delete;
+
+    //
+    // Queues `t` to start on the next `run_ready()`. Returns `false` for an
+    // empty task (its frame could not be allocated).
+    //
+
+    bool spawn(task&& t) {
+        if (!t) {
+            return false;
+        }
+
+        auto& Promise = t.handle_.promise();
+        Promise.owner = this;
+        Promise.node.handle = t.handle_;
+        t.handle_ = nullptr;
+
+        live_++;
+        post(&Promise.node);
+        return true;
+    }
+
+    //
+    // Queues `node->handle` for resumption. Any thread, any IRQL at which
+    // the caller may touch the node.
+    //
+
+    void post(detail::coro_node* node) noexcept {
+        detail::coro_node* Head = __atomic_load_n(&ready_, __ATOMIC_RELAXED);
+        do {
+            node->next = Head;
+        } while (!__atomic_compare_exchange_n(&ready_, &Head, node, true,
+                                              __ATOMIC_RELEASE, __ATOMIC_RELAXED));
+    }
+
+    //
+    // Resumes everything queued so far, in queuing order. Tasks queued
+    // while this runs wait for the next call. Returns the number resumed.
+    //
+
+    size_t run_ready() {
+        detail::coro_node* List = __atomic_exchange_n(&ready_, nullptr, __ATOMIC_ACQUIRE);
+
+        detail::coro_node* Ordered = nullptr;
+        while (List) {
+            detail::coro_node* Next = List->next;
+            List->next = Ordered;
+            Ordered = List;
+            List = Next;
+        }
+
+        size_t Count = 0;
+        while (Ordered) {
+            //
+            // The node lives in the frame and may be reused (or freed) by
+            // the time `resume()` returns.
+            //
+
+            detail::coro_node* Next = Ordered->next;
+            Ordered->handle.resume();
+            Ordered = Next;
+            Count++;
+        }
+
+        return Count;
+    }
+
+    //
+    // Runs until every spawned task has finished. `wait()` is called when
+    // nothing is ready and must return once something may have been posted
+    // - e.g. an alertable `NtDelayExecution` when completions arrive as
+    // APCs, or `async_io::wait()` feeding `completion`s.
+    //
+
+    template <typename F>
+    void run(F&& wait) {
+        while (live_) {
+            if (!run_ready()) {
+                wait();
+            }
+        }
+    }
+
+    __forceinline
+    yield_awaiter yield() {
+        return { this, {} };
+    }
+
+    //
+    // Spawned tasks that have not finished yet.
+    //
+
+    __forceinline
+    size_t live() const {
+        return live_;
+    }
+
+private:
+    friend class task;
+
+    void* allocate_frame(size_t size) {
+        for (auto Link = &free_; *Link; Link = &(*Link)->next) {
+            if ((*Link)->size >= size) {
+                auto Header = *Link;
+                *Link = Header->next;
+                return Header + 1;
+            }
+        }
+
+        if (size > SIZE_MAX - sizeof(detail::coro_frame_header)) {
+            return nullptr;
+        }
+
+        auto Header = static_cast<detail::coro_frame_header*>(
+            frames_->allocate(sizeof(detail::coro_frame_header) + size));
+
+        if (!Header) {
+            return nullptr;
+        }
+
+        Header->size = size;
+        Header->owner = this;
+        return Header + 1;
+    }
+
+    __forceinline
+    void free_frame(detail::coro_frame_header* header) {
+        header->next = free_;
+        free_ = header;
+    }
+
+    __forceinline
+    void finished() {
+        live_--;
+    }
+
+    arena* frames_;
+    detail::coro_node* ready_{};
+    detail::coro_frame_header* free_{};
+    size_t live_{};
+};
+
+template <typename... Args>
+__forceinline
+void* task::promise_type::operator new(size_t size, scheduler& owner, Args&...) noexcept {
+    return owner.allocate_frame(size);
+}
+
+__forceinline
+void task::promise_type::operator delete(void* frame, size_t) noexcept {
+    auto Header = static_cast<detail::coro_frame_header*>(frame) - 1;
+    Header->owner->free_frame(Header);
+}
+
+//
+// The frame is destroyed right at the final suspension point; `resume()`
+// returns to `run_ready()` afterwards.
+//
+
+__forceinline
+void task::promise_type::final_awaiter::await_suspend(std::coroutine_handle<promise_type> handle) noexcept {
+    scheduler* Owner = handle.promise().owner;
+    handle.destroy();
+    Owner->finished();
+}
+
+class completion {
+public:
+    __forceinline
+    explicit completion(scheduler& owner)
+        : owner_(&owner)
+    {}
+
+    completion(const completion&) = delete;
+    completion& operator=(const completion&) = delete;
+
+    //
+    // Signals the awaiting task (or the next `co_await`) with `value`. Any
+    // thread; once per `co_await`.
+    //
+
+    void complete(uintptr_t value = 0) noexcept {
+        value_ = value;
+
+        void* Previous = __atomic_exchange_n(&state_, signaled(), __ATOMIC_ACQ_REL);
+        if (Previous == &node_) {
+            owner_->post(&node_);
+        }
+    }
+
+    __forceinline
+    bool await_ready() const noexcept {
+        return __atomic_load_n(&state_, __ATOMIC_ACQUIRE) == signaled();
+    }
+
+    //
+    // Suspends unless `complete()` got there first.
+    //
+
+    __forceinline
+    bool await_suspend(std::coroutine_handle<> handle) noexcept {
+        node_.handle = handle;
+
+        void* Expected = nullptr;
+        return __atomic_compare_exchange_n(&state_, &Expected, static_cast<void*>(&node_), false,
+                                           __ATOMIC_ACQ_REL, __ATOMIC_ACQUIRE);
+    }
+
+    __forceinline
+    uintptr_t await_resume() noexcept {
+        uintptr_t Value = value_;
+        __atomic_store_n(&state_, nullptr, __ATOMIC_RELAXED);
+        return Value;
+    }
+
+private:
+    __forceinline
+    static void* signaled() {
+        return reinterpret_cast<void*>(uintptr_t{ 1 });
+    }
+
+    scheduler* owner_;
+    detail::coro_node node_{};
+    uintptr_t value_{};
+
+    //
+    // nullptr (idle), `&node_` (a task is waiting) or `signaled()`.
+    //
+
+    void* state_{};
+};
+
+} // namespace sc
@@ -0,0 +1,172 @@
+#pragma once
+
+//
+// Pinned export RVAs.
+//
+// For payloads that target known builds of the guest, the export RVAs of
+// every imported symbol can be looked up offline and baked into the
+// binary. `IMPORT_MODULE` then checks the module's `TimeDateStamp` and
+// `SizeOfImage` once against the builds in the database, and each
+// `IMPORT_SYMBOL` of that module becomes `module + RVA` - no export table
+// walk, no name hashing at runtime. If no build matches, or a symbol isn't
+// in the database for the matching build, the usual lookup is used.
+//
+// Requires `SCFW_ENABLE_PINNED_RVAS`.
+//
+// The database is a header generated by `scripts/gen-pinned-rvas.py` from
+// the guest's binaries. Each module can have several builds, numbered from
+// 1 without gaps; the first one that matches is used:
+//
+//   SCFW_PINNED_MODULE("ntdll.dll", 1, 0x8D3F4A21, 0x001F8000);
+//   SCFW_PINNED_SYMBOL("ntdll.dll", 1, "NtClose", 0x0009D0C0);
+//   SCFW_PINNED_SYMBOL("ntdll.dll", 1, "NtCreateFile", 0x0009D7A0);
+//
+//   SCFW_PINNED_MODULE("ntdll.dll", 2, 0x3B21E0C7, 0x00200000);
+//   SCFW_PINNED_SYMBOL("ntdll.dll", 2, "NtClose", 0x0009E1D0);
+//   SCFW_PINNED_SYMBOL("ntdll.dll", 2, "NtCreateFile", 0x0009E8B0);
+//
+// It must be included after `runtime.h` and before the `IMPORT_MODULE`s
+// it describes:
+//
+//   #include <scfw/runtime.h>
+//   #include <scfw/platform/windows/usermode.h>
+//   #include "pinned_rvas.h"
+//
+//   IMPORT_BEGIN();
+//       IMPORT_MODULE("ntdll.dll");
+//           IMPORT_SYMBOL(NtClose);          // ntdll + 0x0009D0C0 on build 1
+//   IMPORT_END();
+//
+// Modules and symbols are keyed by the same FNV-1a hashes `IMPORT_MODULE`
+// and `IMPORT_SYMBOL` use, so the names never end up in the binary. Only
+// the default (hashed) and `SCFW_FLAG_STRING_SYMBOL` lookups are pinned;
+// `SCFW_FLAG_DYNAMIC_RESOLVE` always goes through `GetProcAddress`.
+//
+// Every build adds one image check to the module's `init()` and one
+// comparison to each pinned symbol's; the RVAs themselves are immediates.
+//
+
+#include <cstdint>
+
+#include "fnv1a.h"
+
+namespace sc {
+namespace detail {
+
+template <uint32_t ModuleHash, uint32_t Build>
+struct pinned_module {
+    static constexpr bool known = false;
+    static constexpr uint32_t time_date_stamp = 0;
+    static constexpr uint32_t size_of_image = 0;
+};
+
+template <uint32_t ModuleHash, uint32_t Build, uint32_t SymbolHash>
+struct pinned_symbol {
+    static constexpr uint32_t rva = 0;
+};
+
+//
+// The first build of `ModuleHash` that `module` matches, or 0.
+//
+
+template <uint32_t ModuleHash, typename Mode, uint32_t Build = 1>
+__forceinline
+uint32_t pinned_build(void* module) {
+    if constexpr (!pinned_module<ModuleHash, Build>::known) {
+        return 0;
+    } else {
+        using entry = pinned_module<ModuleHash, Build>;
+
+        if (Mode::image_matches(module, entry::time_date_stamp, entry::size_of_image)) {
+            return Build;
+        }
+
+        return pinned_build<ModuleHash, Mode, Build + 1>(module);
+    }
+}
+
+//
+// Whether any build of `ModuleHash` pins `SymbolHash`. Without one, the
+// symbol's `init()` has no pinned path at all.
+//
+
+template <uint32_t ModuleHash, uint32_t SymbolHash, uint32_t Build = 1>
+constexpr bool pinned_symbol_known() {
+    if constexpr (!pinned_module<ModuleHash, Build>::known) {
+        return false;
+    } else {
+        return pinned_symbol<ModuleHash, Build, SymbolHash>::rva != 0 ||
+               pinned_symbol_known<ModuleHash, SymbolHash, Build + 1>();
+    }
+}
+
+//
+// The RVA of `SymbolHash` in build `build` of `ModuleHash`, or 0 if that
+// build doesn't pin it.
+//
+
+template <uint32_t ModuleHash, uint32_t SymbolHash, uint32_t Build = 1>
+__forceinline
+uint32_t pinned_rva(uint32_t build) {
+    if constexpr (!pinned_module<ModuleHash, Build>::known) {
+        return 0;
+    } else {
+        if (build == Build) {
+            return pinned_symbol<ModuleHash, Build, SymbolHash>::rva;
+        }
+
+        return pinned_rva<ModuleHash, SymbolHash, Build + 1>(build);
+    }
+}
+
+} // namespace detail
+} // namespace sc
+
+#ifdef SCFW_ENABLE_PINNED_RVAS
+
+#define SCFW_PINNED_MODULE(Module, Build, TimeDateStamp, SizeOfImage)         \
+    namespace sc {                                                            \
+    namespace detail {                                                        \
+    template<>                                                                \
+    struct pinned_module<fnv1a_hash(Module), Build> {                         \
+        static_assert(Build == 1 ||                                           \
+                      pinned_module<fnv1a_hash(Module), Build - 1>::known,    \
+            Module ": pinned builds must be numbered from 1 without gaps");   \
+        static constexpr bool known = true;                                   \
+        static constexpr uint32_t time_date_stamp = TimeDateStamp;            \
+        static constexpr uint32_t size_of_image = SizeOfImage;                \
+    };                                                                        \
+    } /* namespace detail */                                                  \
+    } /* namespace sc */
+
+#define SCFW_PINNED_SYMBOL(Module, Build, Symbol, Rva)                        \
+    namespace sc {                                                            \
+    namespace detail {                                                        \
+    template<>                                                                \
+    struct pinned_symbol<fnv1a_hash(Module), Build, fnv1a_hash(Symbol)> {     \
+        static constexpr uint32_t rva = Rva;                                  \
+    };                                                                        \
+    } /* namespace detail */                                                  \
+    } /* namespace sc */
+
+//
+// Which build the module just found is. Spliced into `IMPORT_MODULE`'s
+// `init()`, where `context.pinned_build` is already 0; expands to nothing
+// without the option.
+//
+
+#define SCFW_PINNED_MODULE_INIT(Module)                                       \
+    context.pinned_build =                                                    \
+        pinned_build<fnv1a_hash(Module), mode>(context.module);
+
+#else
+
+#define SCFW_PINNED_MODULE(Module, Build, TimeDateStamp, SizeOfImage)         \
+    static_assert(false, "pinned RVA database requires SCFW_ENABLE_PINNED_RVAS")
+
+#define SCFW_PINNED_SYMBOL(Module, Build, Symbol, Rva)                        \
+    static_assert(false, "pinned RVA database requires SCFW_ENABLE_PINNED_RVAS")
+
+#define SCFW_PINNED_MODULE_INIT(Module)
+
+#endif
@@ -0,0 +1,404 @@
+#pragma once
+
+//
+// Byte signature scanner.
+//
+// Patterns are written the usual way and parsed at compile time - the
+// binary only contains the bytes and their masks:
+//
+//   constexpr sc::pattern Signature{ "48 8B 05 ?? ?? ?? ?? 48 85 C0 74 ?" };
+//
+//   auto Match = sc::scan_first(Buffer, Signature);   // nullptr if none
+//
+//   sc::scan(Buffer, Signature, [](const uint8_t* Match) {
+//       ...                                           // every match; return
+//   });                                               // false to stop early
+//
+//   const uint8_t* Matches[16];
+//   size_t Count = sc::scan_all(Buffer, Signature, Matches);
+//
+// Tokens are separated by spaces. Each one is a hex byte ("8B"), a full
+// wildcard ("?" or "??") or a byte with one wildcard nibble ("4?", "?5").
+//
+//-----------------------------------------------------------------------------
+// Prefilter
+//-----------------------------------------------------------------------------
+//
+// Comparing the whole pattern at every offset wastes most of the time on
+// positions that fail on the first byte. Instead, the parser picks the two
+// rarest fixed bytes of the pattern (by how often they occur in x86/x64
+// code - `0x00`, `0xFF`, `0x48`, `0x8B` ... are poor anchors) and the scan
+// looks for those two first, 16 (SSE2) or 32 (AVX2) candidate offsets per
+// iteration. Only offsets where both anchors hit are compared in full.
+//
+// x64 uses SSE2 (always present), or AVX2 when the CPU and OS support it,
+// checked with `cpuid`/`xgetbv` on the first scan and cached after that
+// (each `cpuid` is a VM exit under a hypervisor). Kernel-mode payloads
+// never use AVX2, as touching YMM registers there requires
+// `KeSaveExtendedProcessorState`. x86 shellcode is built with `-mno-sse`
+// and uses a scalar loop over the same two anchors.
+//
+// Include after the platform header. For PE images,
+// `platform/windows/image_scan.h` scans only the executable sections.
+//
+
+#include <cstdint>
+#include <cstddef>
+#include <span>
+#include <type_traits>
+
+#ifdef _M_X64
+#   include <immintrin.h>
+#endif
+
+#ifndef SCFW_MODE
+#   error "scan.h requires usermode.h or kernelmode.h to be included first"
+#endif
+
+namespace sc {
+namespace detail {
+
+//
+// Popular bytes in x86/x64 machine code, most frequent first. Bytes not
+// listed count as rare.
+//
+
+consteval uint32_t code_byte_frequency(uint8_t byte) {
+    constexpr uint8_t common[] = {
+        0x00, 0xFF, 0x48, 0x8B, 0x89, 0x24, 0x0F, 0xE8, 0x4C, 0x8D,
+        0x44, 0x85, 0xC0, 0x83, 0x01, 0xCC, 0x74, 0x41, 0x45, 0x49,
+        0x08, 0x10, 0x20, 0x75, 0x33, 0x4D, 0xC3, 0x84, 0x18, 0x28,
+        0x30, 0x38, 0x40, 0x50, 0x90, 0xE9, 0x02, 0x04, 0x03, 0x80,
+    };
+
+    for (size_t i = 0; i < sizeof(common); i++) {
+        if (common[i] == byte) {
+            return static_cast<uint32_t>(sizeof(common) - i);
+        }
+    }
+    return 0;
+}
+
+//
+// Not `constexpr`: reaching it while parsing a pattern makes the pattern
+// fail to compile, with the reason in the diagnostic.
+//
+
+inline void pattern_syntax_error(const char* reason) {
+    (void)reason;
+}
+
+consteval int pattern_nibble(char c) {
+    if (c >= '0' && c <= '9') return c - '0';
+    if (c >= 'a' && c <= 'f') return c - 'a' + 10;
+    if (c >= 'A' && c <= 'F') return c - 'A' + 10;
+    if (c == '?') return -1;
+
+    pattern_syntax_error("invalid character in pattern");
+    return -1;
+}
+
+} // namespace detail
+
+template <size_t N>
+struct pattern {
+    static constexpr size_t capacity = N / 2 + 1;
+
+    consteval pattern(const char (&text)[N]) {
+        size_t i = 0;
+
+        while (i < N - 1) {
+            if (text[i] == ' ') {
+                i++;
+                continue;
+            }
+
+            size_t Length = 0;
+            while (i + Length < N - 1 && text[i + Length] != ' ') {
+                Length++;
+            }
+
+            if (Length == 1 && text[i] == '?') {
+                mask[size] = 0x00;
+            } else if (Length == 2) {
+                int High = detail::pattern_nibble(text[i]);
+                int Low = detail::pattern_nibble(text[i + 1]);
+
+                bytes[size] = static_cast<uint8_t>(((High < 0 ? 0 : High) << 4) | (Low < 0 ? 0 : Low));
+                mask[size] = static_cast<uint8_t>((High < 0 ? 0x00 : 0xF0) | (Low < 0 ? 0x00 : 0x0F));
+            } else {
+                detail::pattern_syntax_error("pattern tokens are one or two characters");
+            }
+
+            size++;
+            i += Length;
+        }
+
+        //
+        // Anchors: the rarest fully specified byte, then the rarest of the
+        // others. A single fixed byte serves as both.
+        //
+
+        size_t Fixed = 0;
+        for (size_t k = 0; k < size; k++) {
+            if (mask[k] != 0xFF) {
+                continue;
+            }
+
+            if (Fixed == 0 || detail::code_byte_frequency(bytes[k]) < detail::code_byte_frequency(bytes[anchor])) {
+                anchor = k;
+            }
+            Fixed++;
+        }
+
+        if (Fixed == 0) {
+            detail::pattern_syntax_error("pattern needs at least one fixed byte");
+        }
+
+        anchor2 = anchor;
+        for (size_t k = 0; k < size; k++) {
+            if (mask[k] != 0xFF || k == anchor) {
+                continue;
+            }
+
+            if (anchor2 == anchor || detail::code_byte_frequency(bytes[k]) < detail::code_byte_frequency(bytes[anchor2])) {
+                anchor2 = k;
+            }
+        }
+    }
+
+    __forceinline
+    bool matches(const uint8_t* data) const {
+        for (size_t k = 0; k < size; k++) {
+            if ((data[k] & mask[k]) != bytes[k]) {
+                return false;
+            }
+        }
+        return true;
+    }
+
+    uint8_t bytes[capacity]{};
+    uint8_t mask[capacity]{};
+    size_t size{};
+    size_t anchor{};
+    size_t anchor2{};
+};
+
+namespace detail {
+
+struct kernel_mode;
+
+//
+// Candidate offsets are `[first, last)`; the caller guarantees that the
+// pattern fits at `last - 1`. `fn` returns `false` to stop the scan, in
+// which case these return `false` as well.
+//
+
+template <size_t N, typename F>
+bool scan_scalar(const uint8_t* data, size_t first, size_t last, const pattern<N>& pat, F& fn) {
+    const uint8_t First = pat.bytes[pat.anchor];
+    const uint8_t Second = pat.bytes[pat.anchor2];
+
+    for (size_t Offset = first; Offset < last; Offset++) {
+        if (data[Offset + pat.anchor] == First &&
+            data[Offset + pat.anchor2] == Second &&
+            pat.matches(data + Offset)) {
+            if (!fn(data + Offset)) {
+                return false;
+            }
+        }
+    }
+    return true;
+}
+
+#ifdef _M_X64
+
+template <size_t N, typename F>
+bool scan_sse2(const uint8_t* data, size_t last, const pattern<N>& pat, F& fn) {
+    const __m128i First = _mm_set1_epi8(static_cast<char>(pat.bytes[pat.anchor]));
+    const __m128i Second = _mm_set1_epi8(static_cast<char>(pat.bytes[pat.anchor2]));
+
+    size_t Offset = 0;
+    for (; Offset + 16 <= last; Offset += 16) {
+        __m128i A = _mm_loadu_si128(reinterpret_cast<const __m128i*>(data + Offset + pat.anchor));
+        __m128i B = _mm_loadu_si128(reinterpret_cast<const __m128i*>(data + Offset + pat.anchor2));
+
+        uint32_t Candidates = static_cast<uint32_t>(_mm_movemask_epi8(
+            _mm_and_si128(_mm_cmpeq_epi8(A, First), _mm_cmpeq_epi8(B, Second))));
+
+        while (Candidates) {
+            const uint8_t* Match = data + Offset + __builtin_ctz(Candidates);
+            if (pat.matches(Match) && !fn(Match)) {
+                return false;
+            }
+            Candidates &= Candidates - 1;
+        }
+    }
+
+    return scan_scalar(data, Offset, last, pat, fn);
+}
+
+template <size_t N, typename F>
+__attribute__((target("avx2")))
+bool scan_avx2(const uint8_t* data, size_t last, const pattern<N>& pat, F& fn) {
+    const __m256i First = _mm256_set1_epi8(static_cast<char>(pat.bytes[pat.anchor]));
+    const __m256i Second = _mm256_set1_epi8(static_cast<char>(pat.bytes[pat.anchor2]));
+
+    size_t Offset = 0;
+    for (; Offset + 32 <= last; Offset += 32) {
+        __m256i A = _mm256_loadu_si256(reinterpret_cast<const __m256i*>(data + Offset + pat.anchor));
+        __m256i B = _mm256_loadu_si256(reinterpret_cast<const __m256i*>(data + Offset + pat.anchor2));
+
+        uint32_t Candidates = static_cast<uint32_t>(_mm256_movemask_epi8(
+            _mm256_and_si256(_mm256_cmpeq_epi8(A, First), _mm256_cmpeq_epi8(B, Second))));
+
+        while (Candidates) {
+            const uint8_t* Match = data + Offset + __builtin_ctz(Candidates);
+            if (pat.matches(Match) && !fn(Match)) {
+                _mm256_zeroupper();
+                return false;
+            }
+            Candidates &= Candidates - 1;
+        }
+    }
+
+    _mm256_zeroupper();
+    return scan_scalar(data, Offset, last, pat, fn);
+}
+
+//
+// AVX2 needs the CPU feature (CPUID.7.0:EBX[5]) and the OS saving YMM
+// state (CPUID.1:ECX.OSXSAVE, XCR0 bits 1 and 2).
+//
+
+__forceinline
+bool cpu_probe_avx2() {
+    uint32_t Eax, Ebx, Ecx, Edx;
+
+    __asm__("cpuid" : "=a"(Eax), "=b"(Ebx), "=c"(Ecx), "=d"(Edx) : "a"(0), "c"(0));
+    if (Eax < 7) {
+        return false;
+    }
+
+    __asm__("cpuid" : "=a"(Eax), "=b"(Ebx), "=c"(Ecx), "=d"(Edx) : "a"(1), "c"(0));
+    if ((Ecx & (1u << 27)) == 0 || (Ecx & (1u << 28)) == 0) {
+        return false;
+    }
+
+    uint32_t XcrLow, XcrHigh;
+    __asm__("xgetbv" : "=a"(XcrLow), "=d"(XcrHigh) : "c"(0));
+    if ((XcrLow & 0x6) != 0x6) {
+        return false;
+    }
+
+    __asm__("cpuid" : "=a"(Eax), "=b"(Ebx), "=c"(Ecx), "=d"(Edx) : "a"(7), "c"(0));
+    return (Ebx & (1u << 5)) != 0;
+}
+
+//
+// `cpu_probe_avx2()`, run once. The cache is constant-initialized, so no
+// guard is emitted; concurrent first scans both probe and store the same
+// value.
+//
+
+__forceinline
+bool cpu_has_avx2() {
+    static int8_t Cached = -1;
+
+    if (Cached < 0) {
+        Cached = cpu_probe_avx2() ? 1 : 0;
+    }
+
+    return Cached != 0;
+}
+
+#endif
+
+template <size_t N, typename F>
+bool scan(std::span<const uint8_t> data, const pattern<N>& pat, F& fn) {
+    if (data.size() < pat.size) {
+        return true;
+    }
+
+    size_t Last = data.size() - pat.size + 1;
+
+#ifdef _M_X64
+    constexpr bool AllowAvx2 = !std::is_same_v<SCFW_MODE, kernel_mode>;
+
+    if constexpr (AllowAvx2) {
+        if (cpu_has_avx2()) {
+            return scan_avx2(data.data(), Last, pat, fn);
+        }
+    }
+
+    return scan_sse2(data.data(), Last, pat, fn);
+#else
+    return scan_scalar(data.data(), 0, Last, pat, fn);
+#endif
+}
+
+} // namespace detail
+
+//
+// Calls `fn(const uint8_t* match)` for every match, in address order. If
+// `fn` returns `bool`, returning `false` stops the scan. Returns the number
+// of matches passed to `fn`.
+//
+
+template <size_t N, typename F>
+size_t scan(std::span<const uint8_t> data, const pattern<N>& pat, F&& fn) {
+    size_t Count = 0;
+
+    auto Callback = [&](const uint8_t* match) {
+        Count++;
+        if constexpr (std::is_void_v<std::invoke_result_t<F&, const uint8_t*>>) {
+            fn(match);
+            return true;
+        } else {
+            return static_cast<bool>(fn(match));
+        }
+    };
+
+    detail::scan(data, pat, Callback);
+    return Count;
+}
+
+//
+// First match, or `nullptr`.
+//
+
+template <size_t N>
+const uint8_t* scan_first(std::span<const uint8_t> data, const pattern<N>& pat) {
+    const uint8_t* Result = nullptr;
+
+    auto Callback = [&](const uint8_t* match) {
+        Result = match;
+        return false;
+    };
+
+    detail::scan(data, pat, Callback);
+    return Result;
+}
+
+//
+// Stores up to `results.size()` matches and returns how many there are in
+// total - more than `results.size()` if some did not fit.
+//
+
+template <size_t N>
+size_t scan_all(std::span<const uint8_t> data, const pattern<N>& pat, std::span<const uint8_t*> results) {
+    size_t Count = 0;
+
+    auto Callback = [&](const uint8_t* match) {
+        if (Count < results.size()) {
+            results[Count] = match;
+        }
+        Count++;
+        return true;
+    };
+
+    detail::scan(data, pat, Callback);
+    return Count;
+}
+
+} // namespace sc
@@ -0,0 +1,170 @@
+#pragma once
+
+//
+// `switch` over strings, by hash.
+//
+// Resident payloads that take textual commands end up with chains of
+// `strcmp`. `SC_SWITCH` hashes the input once (FNV-1a, like imported
+// names) and switches on the hash; every `SC_CASE` label is a hash computed
+// at compile time:
+//
+//   SC_SWITCH(Command) {
+//       SC_CASE("ping")
+//           return reply_pong();
+//
+//       SC_CASE("ls")
+//       SC_CASE("dir")
+//           list(Argument);
+//           break;
+//
+//       default:
+//           return STATUS_NOT_SUPPORTED;
+//   }
+//
+// The input is a NUL-terminated `char`/`wchar_t` string, or a pointer and
+// a length (`SC_SWITCH(Buffer, Length)`). Matching is ASCII
+// case-insensitive, as the hash is.
+//
+//   SC_SWITCH       A hash match is confirmed with one compare against the
+//                   case's literal (`_T()`, so XOR-encoded when enabled).
+//                   An input that merely collides runs `default`.
+//   SC_SWITCH_HASH  Hash only: no case strings end up in the binary, at
+//                   the cost of accepting colliding inputs.
+//
+// Two cases hashing alike are rejected at compile time (duplicate case
+// value). The compiler lowers the switch to compare trees or jump tables;
+// on x86 jump tables are disabled (`-fno-jump-tables`), as their entries
+// are absolute addresses.
+//
+// The switch sits in a hidden one-shot loop: `break` leaves the switch as
+// usual, but `continue` cannot reach a loop around `SC_SWITCH`.
+//
+
+#include <cstdint>
+#include <cstddef>
+#include <type_traits>
+
+#include "fnv1a.h"
+#include "pic.h"
+
+namespace sc {
+namespace detail {
+
+template <typename CharT, bool Confirm>
+class string_switch {
+public:
+    static constexpr bool confirm_enabled = Confirm;
+
+    __forceinline
+    string_switch(const CharT* string, size_t length)
+        : string_(string)
+        , length_(length)
+        , hash_(fnv1a_hash(string, length))
+    {}
+
+    //
+    // The switch runs once on the hash. Only if a case failed confirmation
+    // does it run a second time, on a key no case label can have (case
+    // labels are 32-bit), which lands in `default`.
+    //
+
+    __forceinline
+    bool next() {
+        return pass_++ == 0 || (pass_ == 2 && mismatch_);
+    }
+
+    __forceinline
+    uint64_t key() const {
+        return pass_ == 1 ? hash_ : uint64_t{ 1 } << 32;
+    }
+
+    __forceinline
+    uint32_t hash() const {
+        return hash_;
+    }
+
+    //
+    // Whether the input equals `literal`. Falling through from a confirmed
+    // case into the next label is a match too.
+    //
+
+    __forceinline
+    bool confirm(const char* literal, size_t length) {
+        if (confirmed_) {
+            return true;
+        }
+
+        confirmed_ = equals(literal, length);
+        mismatch_ = !confirmed_;
+        return confirmed_;
+    }
+
+private:
+    __forceinline
+    static uint32_t fold(uint32_t c) {
+        return (c - 'A' < 26) ? c + 0x20 : c;
+    }
+
+    bool equals(const char* literal, size_t length) const {
+        if (length != length_) {
+            return false;
+        }
+
+        for (size_t Index = 0; Index < length; Index++) {
+            using UCharT = std::make_unsigned_t<CharT>;
+            uint32_t Lhs = static_cast<UCharT>(string_[Index]);
+            uint32_t Rhs = static_cast<uint8_t>(literal[Index]);
+
+            if (fold(Lhs) != fold(Rhs)) {
+                return false;
+            }
+        }
+
+        return true;
+    }
+
+    const CharT* string_;
+    size_t length_;
+    uint32_t hash_;
+    uint8_t pass_{};
+    bool confirmed_{};
+    bool mismatch_{};
+};
+
+template <bool Confirm, typename CharT>
+__forceinline
+string_switch<CharT, Confirm> make_string_switch(const CharT* string, size_t length) {
+    return { string, length };
+}
+
+template <bool Confirm, typename CharT>
+__forceinline
+string_switch<CharT, Confirm> make_string_switch(const CharT* string) {
+    return { string, std::char_traits<CharT>::length(string) };
+}
+
+} // namespace detail
+} // namespace sc
+
+#define SC_SWITCH(...)                                                        \
+    for (auto SCFW__switch = ::sc::detail::make_string_switch<true>(__VA_ARGS__); \
+         SCFW__switch.next(); )                                               \
+        switch (SCFW__switch.key())
+
+#define SC_SWITCH_HASH(...)                                                   \
+    for (auto SCFW__switch = ::sc::detail::make_string_switch<false>(__VA_ARGS__); \
+         SCFW__switch.next(); )                                               \
+        switch (SCFW__switch.hash())
+
+//
+// The label and, with `SC_SWITCH`, the confirmation: on a mismatch the
+// switch is left and re-entered at `default`. Written without a colon.
+//
+
+#define SC_CASE(Literal)                                                      \
+    case ::sc::detail::fnv1a_hash(Literal):                                   \
+        if constexpr (decltype(SCFW__switch)::confirm_enabled) {              \
+            if (!SCFW__switch.confirm(_T(Literal), sizeof(Literal) - 1)) {    \
+                break;                                                        \
+            }                                                                 \
+        }
@@ -0,0 +1,335 @@
+#pragma once
+
+//
+// Import-free concurrency building blocks.
+//
+// Everything here is built on the compiler `__atomic` builtins on naturally
+// aligned 32-bit and pointer-sized values, which clang lowers to plain
+// `lock`-prefixed instructions on both x86 and x64 - no CRT helpers, no
+// imports, nothing that has to be resolved. Usable in user-mode and
+// kernel-mode alike.
+//
+//   sc::spinlock<>          - test-and-test-and-set lock with exponential
+//                             backoff. Takes a waiter policy (see below).
+//   sc::spsc_ring<T, N>     - single-producer / single-consumer ring.
+//   sc::mpmc_queue<T, N>    - bounded multi-producer / multi-consumer queue
+//                             (Vyukov's sequence-numbered cells).
+//
+// The queues never block; `try_push()` fails when full and `try_pop()`
+// fails when empty. `N` must be a power of two. Storage is inline, so put
+// the objects on the stack or into an `sc::arena` allocation (placement
+// new) - there is no CRT to run constructors of globals.
+//
+//-----------------------------------------------------------------------------
+// Waiter policies
+//-----------------------------------------------------------------------------
+//
+// A waiter tells the lock how to sleep once spinning stops paying off:
+//
+//   struct waiter {
+//       template <typename T>
+//       static void wait(T* address, T expected);  // returns once *address
+//                                                  // may differ from expected
+//       static void wake_one(void* address);
+//       static void wake_all(void* address);
+//   };
+//
+// `sc::spin_waiter` (the default) just keeps spinning with `pause`.
+// `sc::wait_on_address` (`platform/windows/usermode/wait_on_address.h`)
+// parks the thread with `RtlWaitOnAddress` when it is available.
+//
+
+#include <cstdint>
+#include <cstddef>
+
+namespace sc {
+
+//
+// Spin-loop hint. Lets the sibling hyperthread run and avoids the memory
+// order violation penalty when the awaited cache line finally changes.
+//
+
+__forceinline
+void cpu_relax() {
+    __builtin_ia32_pause();
+}
+
+//
+// Exponential backoff: 1, 2, 4, ... `pause` instructions per round, capped
+// at `max_spins`.
+//
+
+class backoff {
+public:
+    static constexpr uint32_t max_spins = 64;
+
+    __forceinline
+    void pause() {
+        for (uint32_t i = 0; i < spins_; i++) {
+            cpu_relax();
+        }
+
+        if (spins_ < max_spins) {
+            spins_ <<= 1;
+        }
+    }
+
+    __forceinline
+    bool exhausted() const {
+        return spins_ >= max_spins;
+    }
+
+private:
+    uint32_t spins_ = 1;
+};
+
+struct spin_waiter {
+    template <typename T>
+    __forceinline
+    static void wait(T* address, T expected) {
+        backoff Backoff;
+        while (__atomic_load_n(address, __ATOMIC_RELAXED) == expected) {
+            Backoff.pause();
+        }
+    }
+
+    __forceinline static void wake_one(void*) {}
+    __forceinline static void wake_all(void*) {}
+};
+
+//
+// Spinlock.
+//
+// The lock word is 0 (free), 1 (held) or 2 (held, and someone may be
+// sleeping in the waiter). `unlock()` only calls into the waiter in the
+// last case, so the uncontended path is one `xchg` each way.
+//
+
+template <typename Waiter = spin_waiter>
+class spinlock {
+public:
+    __forceinline
+    bool try_lock() {
+        return __atomic_load_n(&state_, __ATOMIC_RELAXED) == 0
+            && __atomic_exchange_n(&state_, 1u, __ATOMIC_ACQUIRE) == 0;
+    }
+
+    void lock() {
+        backoff Backoff;
+
+        while (!Backoff.exhausted()) {
+            if (try_lock()) {
+                return;
+            }
+
+            Backoff.pause();
+        }
+
+        //
+        // Still contended. Mark the lock as having waiters and sleep until
+        // the holder lets go.
+        //
+
+        while (__atomic_exchange_n(&state_, 2u, __ATOMIC_ACQUIRE) != 0) {
+            Waiter::wait(&state_, 2u);
+        }
+    }
+
+    __forceinline
+    void unlock() {
+        if (__atomic_exchange_n(&state_, 0u, __ATOMIC_RELEASE) == 2) {
+            Waiter::wake_one(&state_);
+        }
+    }
+
+private:
+    uint32_t state_ = 0;
+};
+
+//
+// Scoped lock for anything with `lock()` / `unlock()`.
+//
+
+template <typename Lock>
+class lock_guard {
+public:
+    __forceinline explicit lock_guard(Lock& lock) : lock_(lock) { lock_.lock(); }
+    __forceinline ~lock_guard() { lock_.unlock(); }
+
+    lock_guard(const lock_guard&) = delete;
+    lock_guard& operator=(const lock_guard&) = delete;
+
+private:
+    Lock& lock_;
+};
+
+namespace detail {
+
+//
+// Producer and consumer indices live on separate cache lines so the two
+// sides don't bounce the same line back and forth.
+//
+
+inline constexpr size_t cache_line_size = 64;
+
+} // namespace detail
+
+//
+// Single-producer / single-consumer ring.
+//
+// Each side keeps a private copy of the other side's index and only
+// re-reads the shared one when the copy says full (producer) or empty
+// (consumer).
+//
+
+template <typename T, size_t Capacity>
+class spsc_ring {
+    static_assert(Capacity && (Capacity & (Capacity - 1)) == 0,
+                  "Capacity must be a power of two");
+
+public:
+    bool try_push(const T& value) {
+        size_t Tail = producer_.index;
+
+        if (Tail - producer_.cached == Capacity) {
+            producer_.cached = __atomic_load_n(&consumer_.index, __ATOMIC_ACQUIRE);
+            if (Tail - producer_.cached == Capacity) {
+                return false;
+            }
+        }
+
+        slots_[Tail & (Capacity - 1)] = value;
+        __atomic_store_n(&producer_.index, Tail + 1, __ATOMIC_RELEASE);
+        return true;
+    }
+
+    bool try_pop(T& value) {
+        size_t Head = consumer_.index;
+
+        if (Head == consumer_.cached) {
+            consumer_.cached = __atomic_load_n(&producer_.index, __ATOMIC_ACQUIRE);
+            if (Head == consumer_.cached) {
+                return false;
+            }
+        }
+
+        value = slots_[Head & (Capacity - 1)];
+        __atomic_store_n(&consumer_.index, Head + 1, __ATOMIC_RELEASE);
+        return true;
+    }
+
+    //
+    // Approximate when called concurrently with either side.
+    //
+
+    size_t size() const {
+        return __atomic_load_n(&producer_.index, __ATOMIC_ACQUIRE)
+             - __atomic_load_n(&consumer_.index, __ATOMIC_ACQUIRE);
+    }
+
+    static constexpr size_t capacity() { return Capacity; }
+
+private:
+    struct alignas(detail::cache_line_size) side {
+        size_t index = 0;           // Owned; read by the other side.
+        size_t cached = 0;          // Last seen index of the other side.
+    };
+
+    side producer_;
+    side consumer_;
+    T slots_[Capacity];
+};
+
+//
+// Bounded multi-producer / multi-consumer queue.
+//
+// Every cell carries a sequence number telling which "lap" it is ready
+// for: `pos` when free for the producer claiming `pos`, `pos + 1` once
+// filled for the consumer claiming `pos`. Producers and consumers only
+// contend on their own index, and a cell is handed over with a single
+// release store.
+//
+
+template <typename T, size_t Capacity>
+class mpmc_queue {
+    static_assert(Capacity >= 2 && (Capacity & (Capacity - 1)) == 0,
+                  "Capacity must be a power of two (and at least 2)");
+
+public:
+    mpmc_queue() {
+        for (size_t i = 0; i < Capacity; i++) {
+            cells_[i].sequence = i;
+        }
+    }
+
+    mpmc_queue(const mpmc_queue&) = delete;
+    mpmc_queue& operator=(const mpmc_queue&) = delete;
+
+    bool try_push(const T& value) {
+        cell* Cell;
+        size_t Position = __atomic_load_n(&enqueue_, __ATOMIC_RELAXED);
+
+        for (;;) {
+            Cell = &cells_[Position & (Capacity - 1)];
+
+            size_t Sequence = __atomic_load_n(&Cell->sequence, __ATOMIC_ACQUIRE);
+            intptr_t Difference = static_cast<intptr_t>(Sequence - Position);
+
+            if (Difference == 0) {
+                if (__atomic_compare_exchange_n(&enqueue_, &Position, Position + 1,
+                                                true, __ATOMIC_RELAXED, __ATOMIC_RELAXED)) {
+                    break;
+                }
+            } else if (Difference < 0) {
+                return false;
+            } else {
+                Position = __atomic_load_n(&enqueue_, __ATOMIC_RELAXED);
+            }
+        }
+
+        Cell->value = value;
+        __atomic_store_n(&Cell->sequence, Position + 1, __ATOMIC_RELEASE);
+        return true;
+    }
+
+    bool try_pop(T& value) {
+        cell* Cell;
+        size_t Position = __atomic_load_n(&dequeue_, __ATOMIC_RELAXED);
+
+        for (;;) {
+            Cell = &cells_[Position & (Capacity - 1)];
+
+            size_t Sequence = __atomic_load_n(&Cell->sequence, __ATOMIC_ACQUIRE);
+            intptr_t Difference = static_cast<intptr_t>(Sequence - (Position + 1));
+
+            if (Difference == 0) {
+                if (__atomic_compare_exchange_n(&dequeue_, &Position, Position + 1,
+                                                true, __ATOMIC_RELAXED, __ATOMIC_RELAXED)) {
+                    break;
+                }
+            } else if (Difference < 0) {
+                return false;
+            } else {
+                Position = __atomic_load_n(&dequeue_, __ATOMIC_RELAXED);
+            }
+        }
+
+        value = Cell->value;
+        __atomic_store_n(&Cell->sequence, Position + Capacity, __ATOMIC_RELEASE);
+        return true;
+    }
+
+    static constexpr size_t capacity() { return Capacity; }
+
+private:
+    struct cell {
+        size_t sequence;
+        T value;
+    };
+
+    alignas(detail::cache_line_size) size_t enqueue_ = 0;
+    alignas(detail::cache_line_size) size_t dequeue_ = 0;
+    alignas(detail::cache_line_size) cell cells_[Capacity];
+};
+
+} // namespace sc
@@ -0,0 +1,365 @@
+#pragma once
+
+//
+// UTF-16 <-> UTF-8 conversion.
+//
+// Loader and kernel structures hand out UTF-16 (`BaseDllName`,
+// `UNICODE_STRING`, paths), while most payload logic and every hashed or
+// literal name is narrow. These convert between the two without importing
+// `RtlUnicodeToUTF8N` & co:
+//
+//   char Name[64];
+//   size_t Length = sc::narrow_lower(Name, Entry->BaseDllName.Buffer,
+//                                    Entry->BaseDllName.Length / sizeof(wchar_t));
+//
+//   wchar_t Path[MAX_PATH];
+//   sc::widen(Path, _T("\\??\\C:\\Windows\\win.ini"));
+//
+//   narrow(dest, src[, length])       - UTF-16 -> UTF-8
+//   widen(dest, src[, length])        - UTF-8 -> UTF-16
+//   narrow_lower / widen_lower        - same, with ASCII A-Z folded to a-z
+//   narrow_length / widen_length      - output length only, nothing written
+//
+// `length` is in code units of the source; without it, the source is
+// NUL-terminated. Like `snprintf`, the conversions always NUL-terminate a
+// non-empty `dest`, never split a character, and return the length the
+// complete output needs (excluding the terminator) - compare it with
+// `dest.size()` to detect truncation. Unpaired surrogates and malformed
+// UTF-8 become U+FFFD.
+//
+// On x64, runs of ASCII are converted 8 (UTF-16) or 16 (UTF-8) code units
+// at a time with SSE2, folding included. x86 shellcode is built with
+// `-mno-sse` and uses the scalar loop only.
+//
+
+#include <cstdint>
+#include <cstddef>
+#include <span>
+
+#ifdef _M_X64
+#   include <immintrin.h>
+#endif
+
+static_assert(sizeof(wchar_t) == 2, "utf.h expects 16-bit wchar_t");
+
+namespace sc {
+namespace detail {
+
+__forceinline
+uint32_t utf_fold(uint32_t c) {
+    return (c - 'A' < 26) ? c + 0x20 : c;
+}
+
+//
+// Decodes one code point from `src[i]`, advancing `i`.
+//
+
+__forceinline
+uint32_t utf16_decode(const wchar_t* src, size_t length, size_t& i) {
+    uint32_t c = static_cast<uint16_t>(src[i++]);
+
+    if (c - 0xD800 >= 0x800) {
+        return c;
+    }
+
+    if (c < 0xDC00 && i < length) {
+        uint32_t Low = static_cast<uint16_t>(src[i]);
+        if (Low - 0xDC00 < 0x400) {
+            i++;
+            return 0x10000 + ((c - 0xD800) << 10) + (Low - 0xDC00);
+        }
+    }
+
+    return 0xFFFD;
+}
+
+__forceinline
+uint32_t utf8_decode(const char* src, size_t length, size_t& i) {
+    uint32_t c = static_cast<uint8_t>(src[i++]);
+
+    if (c < 0x80) {
+        return c;
+    }
+
+    size_t Extra;
+    uint32_t Minimum;
+
+    if (c - 0xC2 < 0x1E)      { Extra = 1; Minimum = 0x80;    c &= 0x1F; }
+    else if (c - 0xE0 < 0x10) { Extra = 2; Minimum = 0x800;   c &= 0x0F; }
+    else if (c - 0xF0 < 0x05) { Extra = 3; Minimum = 0x10000; c &= 0x07; }
+    else                      { return 0xFFFD; }
+
+    if (length - i < Extra) {
+        return 0xFFFD;
+    }
+
+    for (size_t k = 0; k < Extra; k++) {
+        uint32_t Next = static_cast<uint8_t>(src[i + k]);
+        if ((Next & 0xC0) != 0x80) {
+            i += k;
+            return 0xFFFD;
+        }
+        c = (c << 6) | (Next & 0x3F);
+    }
+
+    i += Extra;
+
+    if (c < Minimum || c > 0x10FFFF || c - 0xD800 < 0x800) {
+        return 0xFFFD;
+    }
+
+    return c;
+}
+
+__forceinline
+size_t utf8_units(uint32_t c) {
+    return c < 0x80 ? 1 : c < 0x800 ? 2 : c < 0x10000 ? 3 : 4;
+}
+
+__forceinline
+void utf8_encode(char* dest, uint32_t c) {
+    uint8_t* d = reinterpret_cast<uint8_t*>(dest);
+
+    if (c < 0x80) {
+        d[0] = static_cast<uint8_t>(c);
+    } else if (c < 0x800) {
+        d[0] = static_cast<uint8_t>(0xC0 | (c >> 6));
+        d[1] = static_cast<uint8_t>(0x80 | (c & 0x3F));
+    } else if (c < 0x10000) {
+        d[0] = static_cast<uint8_t>(0xE0 | (c >> 12));
+        d[1] = static_cast<uint8_t>(0x80 | ((c >> 6) & 0x3F));
+        d[2] = static_cast<uint8_t>(0x80 | (c & 0x3F));
+    } else {
+        d[0] = static_cast<uint8_t>(0xF0 | (c >> 18));
+        d[1] = static_cast<uint8_t>(0x80 | ((c >> 12) & 0x3F));
+        d[2] = static_cast<uint8_t>(0x80 | ((c >> 6) & 0x3F));
+        d[3] = static_cast<uint8_t>(0x80 | (c & 0x3F));
+    }
+}
+
+#ifdef _M_X64
+
+//
+// ASCII A-Z -> a-z on 16-bit or 8-bit lanes holding ASCII only (so the
+// signed compares are safe).
+//
+
+__forceinline
+__m128i utf_fold16(__m128i v) {
+    __m128i Upper = _mm_and_si128(_mm_cmpgt_epi16(v, _mm_set1_epi16('A' - 1)),
+                                  _mm_cmplt_epi16(v, _mm_set1_epi16('Z' + 1)));
+    return _mm_add_epi16(v, _mm_and_si128(Upper, _mm_set1_epi16(0x20)));
+}
+
+__forceinline
+__m128i utf_fold8(__m128i v) {
+    __m128i Upper = _mm_and_si128(_mm_cmpgt_epi8(v, _mm_set1_epi8('A' - 1)),
+                                  _mm_cmplt_epi8(v, _mm_set1_epi8('Z' + 1)));
+    return _mm_add_epi8(v, _mm_and_si128(Upper, _mm_set1_epi8(0x20)));
+}
+
+//
+// Whether 8 UTF-16 code units are all below 0x80.
+//
+
+__forceinline
+bool utf16_ascii8(__m128i v) {
+    __m128i High = _mm_and_si128(v, _mm_set1_epi16(static_cast<short>(0xFF80)));
+    return _mm_movemask_epi8(_mm_cmpeq_epi16(High, _mm_setzero_si128())) == 0xFFFF;
+}
+
+#endif
+
+template <bool Fold>
+size_t narrow(char* dest, size_t capacity, const wchar_t* src, size_t length) {
+    size_t i = 0;
+    size_t Written = 0;
+    size_t Limit = capacity ? capacity - 1 : 0;
+
+    while (i < length) {
+#ifdef _M_X64
+        while (length - i >= 8 && Limit - Written >= 8) {
+            __m128i v = _mm_loadu_si128(reinterpret_cast<const __m128i*>(src + i));
+            if (!utf16_ascii8(v)) {
+                break;
+            }
+
+            if constexpr (Fold) {
+                v = utf_fold16(v);
+            }
+
+            _mm_storel_epi64(reinterpret_cast<__m128i*>(dest + Written), _mm_packus_epi16(v, v));
+            i += 8;
+            Written += 8;
+        }
+
+        if (i == length) {
+            break;
+        }
+#endif
+
+        size_t Next = i;
+        uint32_t c = utf16_decode(src, length, Next);
+        size_t Units = utf8_units(c);
+
+        if (Limit - Written < Units) {
+            break;
+        }
+
+        utf8_encode(dest + Written, Fold ? utf_fold(c) : c);
+        Written += Units;
+        i = Next;
+    }
+
+    if (capacity) {
+        dest[Written] = '\0';
+    }
+
+    //
+    // Truncated: count the rest.
+    //
+
+    size_t Required = Written;
+    while (i < length) {
+#ifdef _M_X64
+        if (length - i >= 8 &&
+            utf16_ascii8(_mm_loadu_si128(reinterpret_cast<const __m128i*>(src + i)))) {
+            i += 8;
+            Required += 8;
+            continue;
+        }
+#endif
+        Required += utf8_units(utf16_decode(src, length, i));
+    }
+
+    return Required;
+}
+
+template <bool Fold>
+size_t widen(wchar_t* dest, size_t capacity, const char* src, size_t length) {
+    size_t i = 0;
+    size_t Written = 0;
+    size_t Limit = capacity ? capacity - 1 : 0;
+
+    while (i < length) {
+#ifdef _M_X64
+        while (length - i >= 16 && Limit - Written >= 16) {
+            __m128i v = _mm_loadu_si128(reinterpret_cast<const __m128i*>(src + i));
+            if (_mm_movemask_epi8(v) != 0) {
+                break;
+            }
+
+            if constexpr (Fold) {
+                v = utf_fold8(v);
+            }
+
+            __m128i Zero = _mm_setzero_si128();
+            _mm_storeu_si128(reinterpret_cast<__m128i*>(dest + Written), _mm_unpacklo_epi8(v, Zero));
+            _mm_storeu_si128(reinterpret_cast<__m128i*>(dest + Written + 8), _mm_unpackhi_epi8(v, Zero));
+            i += 16;
+            Written += 16;
+        }
+
+        if (i == length) {
+            break;
+        }
+#endif
+
+        size_t Next = i;
+        uint32_t c = utf8_decode(src, length, Next);
+        size_t Units = c < 0x10000 ? 1 : 2;
+
+        if (Limit - Written < Units) {
+            break;
+        }
+
+        if (Units == 1) {
+            dest[Written] = static_cast<wchar_t>(Fold ? utf_fold(c) : c);
+        } else {
+            dest[Written] = static_cast<wchar_t>(0xD800 + ((c - 0x10000) >> 10));
+            dest[Written + 1] = static_cast<wchar_t>(0xDC00 + ((c - 0x10000) & 0x3FF));
+        }
+
+        Written += Units;
+        i = Next;
+    }
+
+    if (capacity) {
+        dest[Written] = L'\0';
+    }
+
+    size_t Required = Written;
+    while (i < length) {
+#ifdef _M_X64
+        if (length - i >= 16 &&
+            _mm_movemask_epi8(_mm_loadu_si128(reinterpret_cast<const __m128i*>(src + i))) == 0) {
+            i += 16;
+            Required += 16;
+            continue;
+        }
+#endif
+        Required += utf8_decode(src, length, i) < 0x10000 ? 1 : 2;
+    }
+
+    return Required;
+}
+
+} // namespace detail
+
+//
+// UTF-8 length of a UTF-16 string.
+//
+
+inline size_t narrow_length(const wchar_t* src, size_t length) {
+    return detail::narrow<false>(nullptr, 0, src, length);
+}
+
+inline size_t narrow_length(const wchar_t* src) {
+    return narrow_length(src, wcslen(src));
+}
+
+//
+// UTF-16 length of a UTF-8 string.
+//
+
+inline size_t widen_length(const char* src, size_t length) {
+    return detail::widen<false>(nullptr, 0, src, length);
+}
+
+inline size_t widen_length(const char* src) {
+    return widen_length(src, strlen(src));
+}
+
+inline size_t narrow(std::span<char> dest, const wchar_t* src, size_t length) {
+    return detail::narrow<false>(dest.data(), dest.size(), src, length);
+}
+
+inline size_t narrow(std::span<char> dest, const wchar_t* src) {
+    return narrow(dest, src, wcslen(src));
+}
+
+inline size_t narrow_lower(std::span<char> dest, const wchar_t* src, size_t length) {
+    return detail::narrow<true>(dest.data(), dest.size(), src, length);
+}
+
+inline size_t narrow_lower(std::span<char> dest, const wchar_t* src) {
+    return narrow_lower(dest, src, wcslen(src));
+}
+
+inline size_t widen(std::span<wchar_t> dest, const char* src, size_t length) {
+    return detail::widen<false>(dest.data(), dest.size(), src, length);
+}
+
+inline size_t widen(std::span<wchar_t> dest, const char* src) {
+    return widen(dest, src, strlen(src));
+}
+
+inline size_t widen_lower(std::span<wchar_t> dest, const char* src, size_t length) {
+    return detail::widen<true>(dest.data(), dest.size(), src, length);
+}
+
+inline size_t widen_lower(std::span<wchar_t> dest, const char* src) {
+    return widen_lower(dest, src, strlen(src));
+}
+
+} // namespace sc
@@ -0,0 +1,201 @@
+#!/usr/bin/env python3
+#
+# Generates a pinned RVA database (see lib/include/scfw/runtime/pinned.h)
+# from the binaries of a known guest build.
+#
+#   gen-pinned-rvas.py [-s SYMBOLS] [-o OUTPUT] IMAGE[=NAME] ...
+#
+# IMAGE is a PE file copied from the guest (ntdll.dll, kernel32.dll,
+# ntoskrnl.exe, ...). The module is recorded under its file name, or under
+# NAME if given - e.g. "ntkrnlmp.exe=ntoskrnl.exe", since kernel payloads
+# import the kernel as "ntoskrnl.exe" whatever image was loaded.
+#
+# Several builds of a module can be given (e.g. ntdll.dll from two Windows
+# releases); they are numbered in command line order and the payload uses
+# whichever one matches at runtime. The same build given twice is an error.
+#
+# SYMBOLS is a file with one symbol name per line (or a comma-separated
+# list) restricting the output to the symbols the payload imports. Without
+# it every named export is emitted.
+#
+# Forwarded exports are skipped: their address lives in another module, so
+# they keep going through the regular lookup.
+#
+
+import argparse
+import os
+import struct
+import sys
+
+
+IMAGE_DIRECTORY_ENTRY_EXPORT = 0
+
+
+# Same as sc::detail::fnv1a_hash (runtime/fnv1a.h), which keys the database.
+def fnv1a_hash(name):
+    value = 0x811C9DC5
+    for byte in name.encode('ascii'):
+        if byte >= ord('a'):
+            byte -= 0x20
+        value = ((value ^ byte) * 0x01000193) & 0xFFFFFFFF
+    return value
+
+
+def read_exports(path):
+    with open(path, 'rb') as f:
+        data = f.read()
+
+    if data[:2] != b'MZ':
+        raise ValueError(f'{path}: not a PE image')
+
+    e_lfanew, = struct.unpack_from('<I', data, 0x3C)
+    if data[e_lfanew:e_lfanew + 4] != b'PE\0\0':
+        raise ValueError(f'{path}: bad NT headers signature')
+
+    file_header = e_lfanew + 4
+    number_of_sections, = struct.unpack_from('<H', data, file_header + 2)
+    time_date_stamp, = struct.unpack_from('<I', data, file_header + 4)
+    size_of_optional_header, = struct.unpack_from('<H', data, file_header + 16)
+
+    optional_header = file_header + 20
+    magic, = struct.unpack_from('<H', data, optional_header)
+    if magic == 0x10B:
+        data_directory = optional_header + 96
+    elif magic == 0x20B:
+        data_directory = optional_header + 112
+    else:
+        raise ValueError(f'{path}: unknown optional header magic {magic:#x}')
+
+    size_of_image, = struct.unpack_from('<I', data, optional_header + 56)
+
+    sections = []
+    section_table = optional_header + size_of_optional_header
+    for index in range(number_of_sections):
+        entry = section_table + index * 40
+        virtual_size, virtual_address, raw_size, raw_offset = \
+            struct.unpack_from('<IIII', data, entry + 8)
+        sections.append((virtual_address, max(virtual_size, raw_size), raw_offset))
+
+    def offset(rva):
+        for virtual_address, size, raw_offset in sections:
+            if virtual_address <= rva < virtual_address + size:
+                return raw_offset + rva - virtual_address
+        raise ValueError(f'{path}: RVA {rva:#x} is outside of every section')
+
+    def string(rva):
+        start = offset(rva)
+        return data[start:data.index(b'\0', start)].decode('ascii')
+
+    export_rva, export_size = struct.unpack_from(
+        '<II', data, data_directory + IMAGE_DIRECTORY_ENTRY_EXPORT * 8)
+
+    exports = {}
+    if export_rva:
+        directory = offset(export_rva)
+        (number_of_functions, number_of_names,
+         address_of_functions, address_of_names,
+         address_of_name_ordinals) = struct.unpack_from('<IIIII', data, directory + 20)
+
+        functions = offset(address_of_functions)
+        names = offset(address_of_names)
+        ordinals = offset(address_of_name_ordinals)
+
+        for index in range(number_of_names):
+            name_rva, = struct.unpack_from('<I', data, names + index * 4)
+            ordinal, = struct.unpack_from('<H', data, ordinals + index * 2)
+            if ordinal >= number_of_functions:
+                continue
+
+            function_rva, = struct.unpack_from('<I', data, functions + ordinal * 4)
+            if export_rva <= function_rva < export_rva + export_size:
+                continue
+
+            exports[string(name_rva)] = function_rva
+
+    return time_date_stamp, size_of_image, exports
+
+
+def read_symbols(value):
+    if os.path.isfile(value):
+        with open(value) as f:
+            return {line.strip() for line in f if line.strip() and not line.startswith('#')}
+    return {name.strip() for name in value.split(',') if name.strip()}
+
+
+def main():
+    parser = argparse.ArgumentParser(description='Generate a pinned RVA database header.')
+    parser.add_argument('images', nargs='+', metavar='IMAGE[=NAME]')
+    parser.add_argument('-s', '--symbols', help='symbol list file or comma-separated names')
+    parser.add_argument('-o', '--output', help='output header (default: stdout)')
+    args = parser.parse_args()
+
+    wanted = read_symbols(args.symbols) if args.symbols else None
+    found = set()
+    builds = {}
+
+    lines = [
+        '#pragma once',
+        '',
+        '//',
+        '// Pinned RVA database. Generated by scripts/gen-pinned-rvas.py - do not edit.',
+        '//',
+    ]
+
+    for image in args.images:
+        path, _, name = image.partition('=')
+        name = (name or os.path.basename(path)).lower()
+
+        time_date_stamp, size_of_image, exports = read_exports(path)
+
+        #
+        # A second image with the same build key would never be picked
+        # (the first match wins), so it's almost certainly a mistake.
+        #
+
+        module_builds = builds.setdefault(name, {})
+        key = (time_date_stamp, size_of_image)
+        if key in module_builds:
+            sys.exit(f'error: {path}: same build of {name} as {module_builds[key]} '
+                     f'(TimeDateStamp 0x{time_date_stamp:08X}, SizeOfImage 0x{size_of_image:08X})')
+
+        module_builds[key] = path
+        build = len(module_builds)
+
+        lines.append('')
+        lines.append(f'SCFW_PINNED_MODULE("{name}", {build}, 0x{time_date_stamp:08X}, 0x{size_of_image:08X});')
+
+        #
+        # Names that hash alike (the hash ignores case) can't be told apart
+        # at runtime either; leave them to the regular lookup.
+        #
+
+        hashes = {}
+        for symbol in exports:
+            hashes.setdefault(fnv1a_hash(symbol), []).append(symbol)
+
+        for symbol in sorted(exports):
+            if wanted is not None and symbol not in wanted:
+                continue
+
+            found.add(symbol)
+            if len(hashes[fnv1a_hash(symbol)]) > 1:
+                print(f'warning: {name}!{symbol} collides with '
+                      f'{", ".join(s for s in hashes[fnv1a_hash(symbol)] if s != symbol)}, skipped',
+                      file=sys.stderr)
+                continue
+
+            lines.append(f'SCFW_PINNED_SYMBOL("{name}", {build}, "{symbol}", 0x{exports[symbol]:08X});')
+
+    for symbol in sorted((wanted or set()) - found):
+        print(f'warning: {symbol} is not exported by any image', file=sys.stderr)
+
+    text = '\n'.join(lines) + '\n'
+    if args.output:
+        with open(args.output, 'w', newline='\n') as f:
+            f.write(text)
+    else:
+        sys.stdout.write(text)
+
+
+if __name__ == '__main__':
+    main()
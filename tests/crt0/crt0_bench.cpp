@@ -0,0 +1,306 @@
+//
+// Throughput of crt0.h against libc, per size class.
+//
+// Every routine runs at sizes from 8 B to 1 MiB (powers of two), once as
+// crt0 and once as libc, on the same data:
+//
+//   memcpy     disjoint, 64-byte aligned buffers
+//   memset     64-byte aligned buffer
+//   memmove    overlapping, destination 8 bytes above the source (the
+//              backward copy path)
+//   strcmp     two equal strings in separate buffers: a full scan
+//   _stricmp   two strings equal but for case: a full scan (libc:
+//              strcasecmp)
+//   _wcsicmpa  wide vs narrow, equal but for case (libc: wcscasecmp on
+//              two wide strings - the closest libc has)
+//   strstr     random lowercase haystack, the needle (16 bytes, or the
+//              whole haystack if shorter) is its tail
+//
+// `size` is in bytes, except for _wcsicmpa where it is in characters.
+// Each measurement repeats the call until it has taken at least
+// `--min-time` milliseconds, and the best of `--repeat` measurements is
+// reported, as JSON on stdout (or `--output`):
+//
+//   {
+//     "compiler": "...",
+//     "results": [
+//       { "routine": "memcpy", "impl": "crt0", "size": 8,
+//         "calls": 1234567, "ns_per_call": 2.1, "bytes_per_second": 3.8e9 },
+//       ...
+//     ]
+//   }
+//
+//   crt0_bench [--min-time MS] [--repeat N] [--output FILE] [--quick]
+//
+// `--quick` is one short measurement per point, for smoke testing.
+//
+
+#include <chrono>
+#include <cstdio>
+#include <cstdint>
+#include <cstdlib>
+#include <cstring>
+#include <cwchar>
+#include <string>
+#include <vector>
+
+#include <strings.h>
+
+#include "crt0_host.h"
+
+namespace {
+
+constexpr size_t min_size = 8;
+constexpr size_t max_size = 1024 * 1024;
+constexpr size_t needle_size = 16;
+
+//
+// Results are stored here so calls can't be discarded.
+//
+
+volatile uintptr_t sink;
+
+struct buffers {
+    buffers()
+        : source(max_size + 64)
+        , dest(max_size + 64)
+        , lhs(max_size + 1)
+        , rhs(max_size + 1)
+        , wide_lhs(max_size + 1)
+        , wide_rhs(max_size + 1)
+        , haystack(max_size + 1)
+    {
+        uint32_t State = 0x9E3779B9;
+        for (size_t Index = 0; Index < max_size; Index++) {
+            State ^= State << 13;
+            State ^= State >> 17;
+            State ^= State << 5;
+
+            char Ch = static_cast<char>('a' + State % 26);
+            source[Index] = static_cast<uint8_t>(State >> 8);
+            haystack[Index] = Ch;
+            lhs[Index] = Ch;
+            rhs[Index] = static_cast<char>(Ch - 'a' + 'A');
+            wide_lhs[Index] = static_cast<wchar_t>(Ch);
+            wide_rhs[Index] = static_cast<wchar_t>(Ch - 'a' + 'A');
+        }
+    }
+
+    //
+    // The strings are `size` characters long: a NUL is placed at `size`
+    // and removed again afterwards.
+    //
+
+    void terminate(size_t size) {
+        lhs[size] = rhs[size] = haystack[size] = '\0';
+        wide_lhs[size] = wide_rhs[size] = L'\0';
+    }
+
+    void unterminate(size_t size) {
+        lhs[size] = haystack[size] = 'a';
+        rhs[size] = 'A';
+        wide_lhs[size] = L'a';
+        wide_rhs[size] = L'A';
+    }
+
+    uint8_t* aligned(std::vector<uint8_t>& buffer) {
+        auto Address = reinterpret_cast<uintptr_t>(buffer.data());
+        return buffer.data() + ((64 - Address % 64) % 64);
+    }
+
+    std::vector<uint8_t> source;
+    std::vector<uint8_t> dest;
+    std::vector<char> lhs;
+    std::vector<char> rhs;
+    std::vector<wchar_t> wide_lhs;
+    std::vector<wchar_t> wide_rhs;
+    std::vector<char> haystack;
+};
+
+//
+// One call of a routine at a given size.
+//
+
+using call_fn = void (*)(buffers& data, size_t size);
+
+struct routine {
+    const char* name;
+    call_fn crt0;
+    call_fn libc;
+};
+
+template <typename Memcpy>
+void call_memcpy(buffers& data, size_t size, Memcpy fn) {
+    sink = reinterpret_cast<uintptr_t>(fn(data.aligned(data.dest), data.aligned(data.source), size));
+}
+
+template <typename Memset>
+void call_memset(buffers& data, size_t size, Memset fn) {
+    sink = reinterpret_cast<uintptr_t>(fn(data.aligned(data.dest), static_cast<int>(size), size));
+}
+
+template <typename Memmove>
+void call_memmove(buffers& data, size_t size, Memmove fn) {
+    uint8_t* Base = data.aligned(data.source);
+    sink = reinterpret_cast<uintptr_t>(fn(Base + 8, Base, size));
+}
+
+const char* needle(buffers& data, size_t size) {
+    size_t Length = size < needle_size ? size : needle_size;
+    return data.haystack.data() + size - Length;
+}
+
+const routine routines[] = {
+    {
+        "memcpy",
+        [](buffers& data, size_t size) { call_memcpy(data, size, crt0_host::memcpy); },
+        [](buffers& data, size_t size) { call_memcpy(data, size, std::memcpy); },
+    },
+    {
+        "memset",
+        [](buffers& data, size_t size) { call_memset(data, size, crt0_host::memset); },
+        [](buffers& data, size_t size) { call_memset(data, size, std::memset); },
+    },
+    {
+        "memmove",
+        [](buffers& data, size_t size) { call_memmove(data, size, crt0_host::memmove); },
+        [](buffers& data, size_t size) { call_memmove(data, size, std::memmove); },
+    },
+    {
+        "strcmp",
+        [](buffers& data, size_t) { sink = crt0_host::strcmp(data.lhs.data(), data.haystack.data()); },
+        [](buffers& data, size_t) { sink = std::strcmp(data.lhs.data(), data.haystack.data()); },
+    },
+    {
+        "_stricmp",
+        [](buffers& data, size_t) { sink = crt0_host::stricmp(data.lhs.data(), data.rhs.data()); },
+        [](buffers& data, size_t) { sink = strcasecmp(data.lhs.data(), data.rhs.data()); },
+    },
+    {
+        "_wcsicmpa",
+        [](buffers& data, size_t) { sink = crt0_host::wcsicmpa(data.wide_lhs.data(), data.rhs.data()); },
+        [](buffers& data, size_t) { sink = wcscasecmp(data.wide_lhs.data(), data.wide_rhs.data()); },
+    },
+    {
+        "strstr",
+        [](buffers& data, size_t size) { sink = reinterpret_cast<uintptr_t>(crt0_host::strstr(data.haystack.data(), needle(data, size))); },
+        [](buffers& data, size_t size) { sink = reinterpret_cast<uintptr_t>(std::strstr(data.haystack.data(), needle(data, size))); },
+    },
+};
+
+struct measurement {
+    uint64_t calls;
+    double ns_per_call;
+};
+
+measurement measure(call_fn fn, buffers& data, size_t size, double min_ns, unsigned repeat) {
+    using clock = std::chrono::steady_clock;
+
+    measurement Best{ 0, 0.0 };
+
+    for (unsigned Round = 0; Round < repeat; Round++) {
+        uint64_t Calls = 0;
+        uint64_t Batch = 1;
+        double Elapsed = 0.0;
+
+        auto Start = clock::now();
+        while (Elapsed < min_ns) {
+            for (uint64_t Index = 0; Index < Batch; Index++) {
+                fn(data, size);
+            }
+
+            Calls += Batch;
+            Batch *= 2;
+            Elapsed = std::chrono::duration<double, std::nano>(clock::now() - Start).count();
+        }
+
+        double NsPerCall = Elapsed / static_cast<double>(Calls);
+        if (!Best.calls || NsPerCall < Best.ns_per_call) {
+            Best = { Calls, NsPerCall };
+        }
+    }
+
+    return Best;
+}
+
+const char* compiler() {
+#if defined(__clang__)
+    return "clang " __clang_version__;
+#elif defined(__GNUC__)
+    return "gcc " __VERSION__;
+#else
+    return "unknown";
+#endif
+}
+
+} // namespace
+
+int main(int argc, char** argv) {
+    double MinTimeMs = 20.0;
+    unsigned Repeat = 3;
+    const char* OutputPath = nullptr;
+
+    for (int Index = 1; Index < argc; Index++) {
+        if (!std::strcmp(argv[Index], "--min-time") && Index + 1 < argc) {
+            MinTimeMs = std::strtod(argv[++Index], nullptr);
+        } else if (!std::strcmp(argv[Index], "--repeat") && Index + 1 < argc) {
+            Repeat = static_cast<unsigned>(std::strtoul(argv[++Index], nullptr, 0));
+        } else if (!std::strcmp(argv[Index], "--output") && Index + 1 < argc) {
+            OutputPath = argv[++Index];
+        } else if (!std::strcmp(argv[Index], "--quick")) {
+            MinTimeMs = 0.1;
+            Repeat = 1;
+        } else {
+            std::fprintf(stderr, "Usage: crt0_bench [--min-time MS] [--repeat N] [--output FILE] [--quick]\n");
+            return 2;
+        }
+    }
+
+    if (!Repeat) {
+        Repeat = 1;
+    }
+
+    FILE* Output = OutputPath ? std::fopen(OutputPath, "w") : stdout;
+    if (!Output) {
+        std::perror(OutputPath);
+        return 1;
+    }
+
+    buffers Data;
+
+    std::fprintf(Output, "{\n  \"compiler\": \"%s\",\n  \"results\": [", compiler());
+
+    bool First = true;
+    for (const auto& Routine : routines) {
+        for (size_t Size = min_size; Size <= max_size; Size *= 2) {
+            Data.terminate(Size);
+
+            for (int Impl = 0; Impl < 2; Impl++) {
+                call_fn Fn = Impl == 0 ? Routine.crt0 : Routine.libc;
+                measurement Result = measure(Fn, Data, Size, MinTimeMs * 1e6, Repeat);
+
+                std::fprintf(Output,
+                             "%s\n    { \"routine\": \"%s\", \"impl\": \"%s\", \"size\": %zu, "
+                             "\"calls\": %llu, \"ns_per_call\": %.3f, \"bytes_per_second\": %.6g }",
+                             First ? "" : ",",
+                             Routine.name,
+                             Impl == 0 ? "crt0" : "libc",
+                             Size,
+                             static_cast<unsigned long long>(Result.calls),
+                             Result.ns_per_call,
+                             static_cast<double>(Size) * 1e9 / Result.ns_per_call);
+                First = false;
+            }
+
+            Data.unterminate(Size);
+        }
+    }
+
+    std::fprintf(Output, "\n  ]\n}\n");
+
+    if (Output != stdout) {
+        std::fclose(Output);
+    }
+
+    return 0;
+}
@@ -0,0 +1,87 @@
+//
+// Compiles crt0.h for the host.
+//
+// crt0.h defines its routines with their standard names and C linkage, so
+// they are renamed before it is included. This translation unit includes
+// no libc header, so the renamed definitions can't clash with libc's, and
+// it is compiled with the flags payloads use (`-ffreestanding
+// -fno-builtin`, see CMakeLists.txt) so the compiler keeps the loops as
+// written instead of turning them back into libc calls.
+//
+// `SCFW_CRT0_HEADER` selects the header, so a candidate variant can be
+// tested and measured against the current one.
+//
+
+#define memcmp      scfw_crt0_memcmp
+#define memset      scfw_crt0_memset
+#define memcpy      scfw_crt0_memcpy
+#define memmove     scfw_crt0_memmove
+#define memchr      scfw_crt0_memchr
+#define strlen      scfw_crt0_strlen
+#define wcslen      scfw_crt0_wcslen
+#define strcpy      scfw_crt0_strcpy
+#define wcscpy      scfw_crt0_wcscpy
+#define strncpy     scfw_crt0_strncpy
+#define strcmp      scfw_crt0_strcmp
+#define strncmp     scfw_crt0_strncmp
+#define _stricmp    scfw_crt0_stricmp
+#define _wcsicmp    scfw_crt0_wcsicmp
+#define _Xstricmp   scfw_crt0_Xstricmp
+#define _wcsicmpa   scfw_crt0_wcsicmpa
+#define strcat      scfw_crt0_strcat
+#define strncat     scfw_crt0_strncat
+#define strchr      scfw_crt0_strchr
+#define wcschr      scfw_crt0_wcschr
+#define strrchr     scfw_crt0_strrchr
+#define strstr      scfw_crt0_strstr
+
+#define __forceinline inline __attribute__((always_inline))
+#define __cdecl
+
+//
+// The Windows SDK's <cstdint> brings `size_t` along; glibc's doesn't.
+//
+
+#include <stddef.h>
+
+#include SCFW_CRT0_HEADER
+
+#undef memset
+#undef memcpy
+#undef memmove
+#undef strcmp
+#undef strstr
+
+#include "crt0_host.h"
+
+namespace crt0_host {
+
+void* memcpy(void* dest, const void* src, size_t count) {
+    return scfw_crt0_memcpy(dest, src, count);
+}
+
+void* memset(void* dest, int ch, size_t count) {
+    return scfw_crt0_memset(dest, ch, count);
+}
+
+void* memmove(void* dest, const void* src, size_t count) {
+    return scfw_crt0_memmove(dest, src, count);
+}
+
+int strcmp(const char* lhs, const char* rhs) {
+    return scfw_crt0_strcmp(lhs, rhs);
+}
+
+int stricmp(const char* lhs, const char* rhs) {
+    return scfw_crt0_stricmp(lhs, rhs);
+}
+
+int wcsicmpa(const wchar_t* lhs, const char* rhs) {
+    return scfw_crt0_wcsicmpa(lhs, rhs);
+}
+
+const char* strstr(const char* str, const char* substr) {
+    return scfw_crt0_strstr(str, substr);
+}
+
+} // namespace crt0_host
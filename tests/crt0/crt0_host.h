@@ -0,0 +1,20 @@
+#pragma once
+
+//
+// crt0.h's routines, compiled for the host by `crt0_host.cpp` and exported
+// under `crt0_host::` so they can be called side by side with libc's.
+//
+
+#include <cstddef>
+
+namespace crt0_host {
+
+void* memcpy(void* dest, const void* src, size_t count);
+void* memset(void* dest, int ch, size_t count);
+void* memmove(void* dest, const void* src, size_t count);
+int strcmp(const char* lhs, const char* rhs);
+int stricmp(const char* lhs, const char* rhs);
+int wcsicmpa(const wchar_t* lhs, const char* rhs);
+const char* strstr(const char* str, const char* substr);
+
+} // namespace crt0_host
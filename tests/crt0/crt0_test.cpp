@@ -0,0 +1,451 @@
+//
+// Differential test of crt0.h against libc.
+//
+// Every case runs the libc routine and the crt0 routine on identical
+// copies of the same memory and compares the results: the returned value
+// (comparisons by sign, pointers by offset) and, for the mem* routines,
+// the whole destination buffer including the bytes around the written
+// range, so writes out of bounds are caught too.
+//
+// The mem* routines are first checked exhaustively for small sizes and
+// alignments, then randomly across sizes up to 64 KiB, source and
+// destination alignments and (memmove) overlaps in both directions.
+// String routines get random strings that share long prefixes and differ
+// in case, so the interesting paths (equal prefixes, case folding, near
+// matches) are taken often.
+//
+// _stricmp is checked against strcasecmp. _wcsicmpa has no libc
+// counterpart; its reference is wcscasecmp on the widened narrow string.
+// Narrow strings passed to it are ASCII (module names are), and the
+// non-ASCII wide characters come from a caseless range (CJK), where
+// crt0's ASCII-only folding and wcscasecmp agree.
+//
+//   crt0_test [--iterations N] [--seed S]
+//
+
+#include <cstdio>
+#include <cstdint>
+#include <cstdlib>
+#include <cstring>
+#include <cwchar>
+#include <string>
+#include <vector>
+
+#include <strings.h>
+
+#include "crt0_host.h"
+
+namespace {
+
+class rng {
+public:
+    explicit rng(uint64_t seed)
+        : state_(seed ? seed : 0x9E3779B97F4A7C15)
+    {}
+
+    uint64_t next() {
+        state_ ^= state_ << 13;
+        state_ ^= state_ >> 7;
+        state_ ^= state_ << 17;
+        return state_;
+    }
+
+    //
+    // [0, bound)
+    //
+
+    size_t below(size_t bound) {
+        return bound ? static_cast<size_t>(next() % bound) : 0;
+    }
+
+    bool chance(unsigned percent) {
+        return below(100) < percent;
+    }
+
+    //
+    // Mostly small sizes (where call overhead and tails matter), some
+    // medium, a few large.
+    //
+
+    size_t size(size_t max) {
+        switch (below(4)) {
+            case 0:  return below(17);
+            case 1:  return below(257);
+            case 2:  return below(4097);
+            default: return below(max + 1);
+        }
+    }
+
+private:
+    uint64_t state_;
+};
+
+int failures = 0;
+
+template <typename... Args>
+void fail(const char* routine, const char* format, Args... args) {
+    if (failures++ < 20) {
+        std::fprintf(stderr, "FAIL %s: ", routine);
+        std::fprintf(stderr, format, args...);
+        std::fputc('\n', stderr);
+    }
+}
+
+int sign(int value) {
+    return (value > 0) - (value < 0);
+}
+
+constexpr size_t max_size = 64 * 1024;
+constexpr size_t slack = 128;
+
+//////////////////////////////////////////////////////////////////////////
+// mem*
+//////////////////////////////////////////////////////////////////////////
+
+struct mem_buffers {
+    explicit mem_buffers(rng& random)
+        : source(3 * max_size + 4 * slack)
+        , background(source.size())
+        , expected(source.size())
+        , actual(source.size())
+    {
+        for (auto& Byte : source) {
+            Byte = static_cast<uint8_t>(random.next());
+        }
+
+        for (auto& Byte : background) {
+            Byte = static_cast<uint8_t>(random.next());
+        }
+    }
+
+    //
+    // Both destinations start out as the same bytes in `[begin, end)`,
+    // which covers the written range plus `slack` bytes on either side, so
+    // anything written out of bounds shows up as a difference.
+    //
+
+    void reset(size_t begin, size_t end) {
+        std::memcpy(expected.data() + begin, background.data() + begin, end - begin);
+        std::memcpy(actual.data() + begin, background.data() + begin, end - begin);
+    }
+
+    bool same(size_t begin, size_t end) const {
+        return std::memcmp(expected.data() + begin, actual.data() + begin, end - begin) == 0;
+    }
+
+    std::vector<uint8_t> source;
+    std::vector<uint8_t> background;
+    std::vector<uint8_t> expected;
+    std::vector<uint8_t> actual;
+};
+
+//
+// Whether both calls returned the same position in their buffer.
+//
+
+bool same_result(const mem_buffers& buffers, const void* expected, const void* actual) {
+    return static_cast<const uint8_t*>(expected) - buffers.expected.data() ==
+           static_cast<const uint8_t*>(actual) - buffers.actual.data();
+}
+
+void check_memcpy(mem_buffers& buffers, size_t size, size_t source_offset, size_t dest_offset) {
+    size_t Dest = slack + dest_offset;
+    buffers.reset(0, Dest + size + slack);
+
+    const uint8_t* Source = buffers.source.data() + source_offset;
+    void* Expected = std::memcpy(buffers.expected.data() + Dest, Source, size);
+    void* Actual = crt0_host::memcpy(buffers.actual.data() + Dest, Source, size);
+
+    if (!same_result(buffers, Expected, Actual)) {
+        fail("memcpy", "size %zu src+%zu dst+%zu: wrong return value", size, source_offset, dest_offset);
+    }
+
+    if (!buffers.same(0, Dest + size + slack)) {
+        fail("memcpy", "size %zu src+%zu dst+%zu: buffers differ", size, source_offset, dest_offset);
+    }
+}
+
+void check_memset(mem_buffers& buffers, size_t size, size_t dest_offset, int ch) {
+    size_t Dest = slack + dest_offset;
+    buffers.reset(0, Dest + size + slack);
+
+    void* Expected = std::memset(buffers.expected.data() + Dest, ch, size);
+    void* Actual = crt0_host::memset(buffers.actual.data() + Dest, ch, size);
+
+    if (!same_result(buffers, Expected, Actual)) {
+        fail("memset", "size %zu dst+%zu ch %d: wrong return value", size, dest_offset, ch);
+    }
+
+    if (!buffers.same(0, Dest + size + slack)) {
+        fail("memset", "size %zu dst+%zu ch %d: buffers differ", size, dest_offset, ch);
+    }
+}
+
+//
+// Moves within one buffer; `source` and `dest` are absolute offsets (at
+// least `slack`), so any overlap can be expressed.
+//
+
+void check_memmove(mem_buffers& buffers, size_t size, size_t source, size_t dest) {
+    size_t Begin = (source < dest ? source : dest) - slack;
+    size_t End = (source > dest ? source : dest) + size + slack;
+    buffers.reset(Begin, End);
+
+    void* Expected = std::memmove(buffers.expected.data() + dest, buffers.expected.data() + source, size);
+    void* Actual = crt0_host::memmove(buffers.actual.data() + dest, buffers.actual.data() + source, size);
+
+    if (!same_result(buffers, Expected, Actual)) {
+        fail("memmove", "size %zu src %zu dst %zu: wrong return value", size, source, dest);
+    }
+
+    if (!buffers.same(Begin, End)) {
+        fail("memmove", "size %zu src %zu dst %zu: buffers differ", size, source, dest);
+    }
+}
+
+void test_mem(rng& random, size_t iterations) {
+    mem_buffers Buffers{ random };
+
+    for (size_t Size = 0; Size <= 128; Size++) {
+        for (size_t SourceOffset = 0; SourceOffset < 16; SourceOffset++) {
+            for (size_t DestOffset = 0; DestOffset < 16; DestOffset++) {
+                check_memcpy(Buffers, Size, SourceOffset, DestOffset);
+                check_memmove(Buffers, Size, slack + SourceOffset, slack + DestOffset);
+            }
+
+            check_memset(Buffers, Size, SourceOffset, static_cast<int>(Size * 37));
+        }
+    }
+
+    for (size_t Iteration = 0; Iteration < iterations; Iteration++) {
+        size_t Size = random.size(max_size);
+
+        check_memcpy(Buffers, Size, random.below(64), random.below(64));
+
+        //
+        // Includes values outside of [0, 255]: only the low byte counts.
+        //
+
+        int Ch = static_cast<int>(random.next() % 1024) - 512;
+        check_memset(Buffers, Size, random.below(64), Ch);
+
+        //
+        // Destination anywhere from `Size` bytes before to `Size` bytes
+        // after the source: disjoint and overlapping in both directions.
+        //
+
+        size_t Source = slack + max_size + random.below(64);
+        size_t Distance = random.below(Size + 1);
+        size_t Dest = random.chance(50) ? Source + Distance : Source - Distance;
+        check_memmove(Buffers, Size, Source, Dest);
+    }
+}
+
+//////////////////////////////////////////////////////////////////////////
+// Strings
+//////////////////////////////////////////////////////////////////////////
+
+//
+// A small random alphabet per string pair makes equal prefixes (and, for
+// strstr, partial matches) likely.
+//
+
+std::string random_alphabet(rng& random, bool ascii) {
+    static const char Mixed[] = "aAbBzZ09_@[`{~";
+    std::string Alphabet;
+
+    size_t Count = 1 + random.below(4);
+    for (size_t Index = 0; Index < Count; Index++) {
+        if (!ascii && random.chance(25)) {
+            Alphabet += static_cast<char>(0x80 + random.below(0x80));
+        } else if (random.chance(50)) {
+            Alphabet += Mixed[random.below(sizeof(Mixed) - 1)];
+        } else {
+            Alphabet += static_cast<char>(1 + random.below(0x7F));
+        }
+    }
+
+    return Alphabet;
+}
+
+std::string random_string(rng& random, const std::string& alphabet, size_t length) {
+    std::string String(length, '\0');
+    for (auto& Ch : String) {
+        Ch = alphabet[random.below(alphabet.size())];
+    }
+    return String;
+}
+
+char flip_case(char ch) {
+    if (ch >= 'a' && ch <= 'z') return static_cast<char>(ch - 'a' + 'A');
+    if (ch >= 'A' && ch <= 'Z') return static_cast<char>(ch - 'A' + 'a');
+    return ch;
+}
+
+//
+// `rhs` is `lhs` with case flips, then maybe one changed character,
+// maybe truncated or extended.
+//
+
+std::string derive_string(rng& random, const std::string& lhs, const std::string& alphabet, bool flip) {
+    std::string Rhs = lhs;
+
+    if (flip) {
+        for (auto& Ch : Rhs) {
+            if (random.chance(50)) {
+                Ch = flip_case(Ch);
+            }
+        }
+    }
+
+    if (!Rhs.empty() && random.chance(40)) {
+        Rhs[random.below(Rhs.size())] = alphabet[random.below(alphabet.size())];
+    }
+
+    if (random.chance(20)) {
+        Rhs.resize(random.below(Rhs.size() + 1));
+    } else if (random.chance(20)) {
+        Rhs += random_string(random, alphabet, 1 + random.below(4));
+    }
+
+    return Rhs;
+}
+
+//
+// Copies `string` to a random alignment within `storage`.
+//
+
+const char* place(rng& random, std::vector<char>& storage, const std::string& string) {
+    size_t Offset = random.below(64);
+    storage.assign(Offset + string.size() + 1, '\x7F');
+    std::memcpy(storage.data() + Offset, string.c_str(), string.size() + 1);
+    return storage.data() + Offset;
+}
+
+void test_strcmp(rng& random, size_t iterations) {
+    std::vector<char> LhsStorage, RhsStorage;
+
+    for (size_t Iteration = 0; Iteration < iterations; Iteration++) {
+        std::string Alphabet = random_alphabet(random, false);
+        std::string LhsString = random_string(random, Alphabet, random.size(1024));
+        std::string RhsString = derive_string(random, LhsString, Alphabet, false);
+
+        const char* Lhs = place(random, LhsStorage, LhsString);
+        const char* Rhs = place(random, RhsStorage, RhsString);
+
+        if (sign(crt0_host::strcmp(Lhs, Rhs)) != sign(std::strcmp(Lhs, Rhs))) {
+            fail("strcmp", "\"%s\" vs \"%s\"", Lhs, Rhs);
+        }
+    }
+}
+
+void test_stricmp(rng& random, size_t iterations) {
+    std::vector<char> LhsStorage, RhsStorage;
+
+    for (size_t Iteration = 0; Iteration < iterations; Iteration++) {
+        std::string Alphabet = random_alphabet(random, false);
+        std::string LhsString = random_string(random, Alphabet, random.size(1024));
+        std::string RhsString = derive_string(random, LhsString, Alphabet, true);
+
+        const char* Lhs = place(random, LhsStorage, LhsString);
+        const char* Rhs = place(random, RhsStorage, RhsString);
+
+        if (sign(crt0_host::stricmp(Lhs, Rhs)) != sign(strcasecmp(Lhs, Rhs))) {
+            fail("_stricmp", "\"%s\" vs \"%s\"", Lhs, Rhs);
+        }
+    }
+}
+
+void test_wcsicmpa(rng& random, size_t iterations) {
+    std::vector<char> RhsStorage;
+
+    for (size_t Iteration = 0; Iteration < iterations; Iteration++) {
+        std::string Alphabet = random_alphabet(random, true);
+        std::string Narrow = random_string(random, Alphabet, random.size(256));
+        std::string RhsString = derive_string(random, Narrow, Alphabet, true);
+
+        std::wstring Lhs(Narrow.begin(), Narrow.end());
+        if (!Lhs.empty() && random.chance(10)) {
+            Lhs[random.below(Lhs.size())] = static_cast<wchar_t>(0x4E00 + random.below(0x100));
+        }
+
+        const char* Rhs = place(random, RhsStorage, RhsString);
+        std::wstring WideRhs(RhsString.begin(), RhsString.end());
+
+        if (sign(crt0_host::wcsicmpa(Lhs.c_str(), Rhs)) != sign(wcscasecmp(Lhs.c_str(), WideRhs.c_str()))) {
+            fail("_wcsicmpa", "L\"%ls\" vs \"%s\"", Lhs.c_str(), Rhs);
+        }
+    }
+}
+
+void test_strstr(rng& random, size_t iterations) {
+    std::vector<char> HaystackStorage, NeedleStorage;
+
+    for (size_t Iteration = 0; Iteration < iterations; Iteration++) {
+        std::string Alphabet = random_alphabet(random, false);
+        std::string HaystackString = random_string(random, Alphabet, random.size(512));
+
+        //
+        // A piece of the haystack (found unless mutated), or an unrelated
+        // string over the same alphabet.
+        //
+
+        std::string NeedleString;
+        if (!HaystackString.empty() && random.chance(70)) {
+            size_t Start = random.below(HaystackString.size());
+            NeedleString = HaystackString.substr(Start, random.below(HaystackString.size() - Start + 1));
+
+            if (!NeedleString.empty() && random.chance(30)) {
+                NeedleString[random.below(NeedleString.size())] = Alphabet[random.below(Alphabet.size())];
+            }
+        } else {
+            NeedleString = random_string(random, Alphabet, random.below(8));
+        }
+
+        const char* Haystack = place(random, HaystackStorage, HaystackString);
+        const char* Needle = place(random, NeedleStorage, NeedleString);
+
+        const char* Expected = std::strstr(Haystack, Needle);
+        const char* Actual = crt0_host::strstr(Haystack, Needle);
+
+        if (Expected != Actual) {
+            fail("strstr", "\"%s\" in \"%s\": expected %td, got %td", Needle, Haystack,
+                 Expected ? Expected - Haystack : -1, Actual ? Actual - Haystack : -1);
+        }
+    }
+}
+
+} // namespace
+
+int main(int argc, char** argv) {
+    size_t Iterations = 20000;
+    uint64_t Seed = 1;
+
+    for (int Index = 1; Index < argc; Index++) {
+        if (!std::strcmp(argv[Index], "--iterations") && Index + 1 < argc) {
+            Iterations = std::strtoull(argv[++Index], nullptr, 0);
+        } else if (!std::strcmp(argv[Index], "--seed") && Index + 1 < argc) {
+            Seed = std::strtoull(argv[++Index], nullptr, 0);
+        } else {
+            std::fprintf(stderr, "Usage: crt0_test [--iterations N] [--seed S]\n");
+            return 2;
+        }
+    }
+
+    rng Random{ Seed };
+
+    test_mem(Random, Iterations);
+    test_strcmp(Random, Iterations);
+    test_stricmp(Random, Iterations);
+    test_wcsicmpa(Random, Iterations);
+    test_strstr(Random, Iterations);
+
+    if (failures) {
+        std::fprintf(stderr, "%d failure(s) (seed %llu)\n", failures, static_cast<unsigned long long>(Seed));
+        return 1;
+    }
+
+    std::printf("crt0: all routines match libc (%zu iterations, seed %llu)\n",
+                Iterations, static_cast<unsigned long long>(Seed));
+    return 0;
+}
@@ -2,6 +2,23 @@
 #include <windows.h>
 #include <stdio.h>
 #include <stdlib.h>
+#include <string.h>
+
+//
+// Mirrors sc::entry_result (lib/include/scfw/runtime.h). Shellcodes built
+// with SCFW_OPT_RESULT fill it in; others leave it untouched.
+//
+
+typedef struct _ENTRY_RESULT
+{
+    ULONG_PTR Status;
+    UINT32 FailedImport;
+} ENTRY_RESULT;
+
+#define RESULT_INIT_FAILED ((ULONG_PTR)~(ULONG_PTR)0)
+
+typedef ULONG_PTR (__fastcall* ShellcodeEntry)(PVOID, PVOID, ENTRY_RESULT*);
+typedef VOID (__fastcall* ShellcodeEntryNoResult)(PVOID, PVOID);
 
 int
 main(
@@ -9,13 +26,37 @@ main(
     char** argv
     )
 {
+    //
+    // Parse options.
+    //
+
+    BOOL UseResult = FALSE;
+
+    if (argc > 1 && strcmp(argv[1], "-r") == 0)
+    {
+        UseResult = TRUE;
+        argv++;
+        argc--;
+    }
+
+#ifdef _WIN64
+    //
+    // On x64 the third argument travels in R8, which a two-argument
+    // shellcode simply ignores, so it is always passed.
+    //
+
+    UseResult = TRUE;
+#endif
+
     if (argc < 2)
     {
-        fprintf(stderr, "Usage: scrun <input.bin> [arg1] [arg2]\n");
+        fprintf(stderr, "Usage: scrun [-r] <input.bin> [arg1] [arg2]\n");
         fprintf(stderr, "\n");
         fprintf(stderr, "Loads and executes a shellcode binary.\n");
         fprintf(stderr, "\n");
         fprintf(stderr, "Arguments:\n");
+        fprintf(stderr, "  -r         Pass an entry_result and report it (SCFW_OPT_RESULT);\n");
+        fprintf(stderr, "             always on for x64, required on x86 for RESULT builds\n");
         fprintf(stderr, "  input.bin  Path to the shellcode binary file\n");
         fprintf(stderr, "  arg1       Optional first argument (passed in RCX/ECX)\n");
         fprintf(stderr, "  arg2       Optional second argument (passed in RDX/EDX)\n");
@@ -116,14 +157,48 @@ main(
     // The shellcode entry point signature is:
     //   void __fastcall entry(void* argument1, void* argument2)
     //
+    // or, with SCFW_OPT_RESULT:
+    //   uintptr_t __fastcall entry(void* argument1, void* argument2,
+    //                              sc::entry_result* result)
+    //
+    // On x86 a RESULT shellcode pops `result` off the stack and a plain one
+    // doesn't, so the two prototypes can't be mixed there; -r picks one.
+    //
 
-    typedef void (__fastcall* ShellcodeEntry)(PVOID, PVOID);
-    ShellcodeEntry Shellcode = (ShellcodeEntry)BaseAddress;
+    ENTRY_RESULT Result = { 0 };
 
-    Shellcode(Arg1, Arg2);
+    if (UseResult)
+    {
+        ShellcodeEntry Shellcode = (ShellcodeEntry)BaseAddress;
+        Shellcode(Arg1, Arg2, &Result);
+    }
+    else
+    {
+        ShellcodeEntryNoResult Shellcode = (ShellcodeEntryNoResult)BaseAddress;
+        Shellcode(Arg1, Arg2);
+    }
 
     printf("\n[ ] Shellcode returned\n");
 
+    //
+    // Report the result. Without SCFW_OPT_RESULT, the shellcode leaves it
+    // zeroed.
+    //
+
+    if (UseResult)
+    {
+        if (Result.Status == RESULT_INIT_FAILED)
+        {
+            printf("[*] Status: init failed (import 0x%08X)\n",
+                   Result.FailedImport);
+        }
+        else
+        {
+            printf("[ ] Status: 0x%p, failed import: 0x%08X\n",
+                   (PVOID)Result.Status, Result.FailedImport);
+        }
+    }
+
     //
     // Test if the shellcode freed itself. If not, free the memory here.
     //